@@ -0,0 +1,122 @@
+#include <sstream>
+
+#include <benchmark/benchmark.h>
+
+#include "synthetic_factory.h"
+#include "../src/game/game.h"
+
+using namespace Fac;
+
+// factories from 100 to 1M entities
+static void jsonFactorySizes(benchmark::internal::Benchmark *b) {
+    b->RangeMultiplier(10)->Range(100, 1'000'000)->Unit(benchmark::kMillisecond);
+}
+
+static void BM_FactoryToJson(benchmark::State &state) {
+    auto const f = Bench::syntheticFactory(state.range(0));
+    for (auto _: state) {
+        json j = *f;
+        benchmark::DoNotOptimize(j);
+    }
+    state.SetItemsProcessed(state.iterations() * f->getEntities().size());
+}
+
+BENCHMARK(BM_FactoryToJson)->Apply(jsonFactorySizes);
+
+static void BM_FactoryFromJson(benchmark::State &state) {
+    json const j = *Bench::syntheticFactory(state.range(0));
+    for (auto _: state) {
+        auto f = j.get<Factory>();
+        benchmark::DoNotOptimize(f);
+    }
+    state.SetItemsProcessed(state.iterations() * j.at("entities").size());
+}
+
+BENCHMARK(BM_FactoryFromJson)->Apply(jsonFactorySizes);
+
+static void BM_FactoryJsonRoundTrip(benchmark::State &state) {
+    auto const f = Bench::syntheticFactory(state.range(0));
+    for (auto _: state) {
+        json const j = *f;
+        auto f2 = j.get<Factory>();
+        benchmark::DoNotOptimize(f2);
+    }
+    state.SetItemsProcessed(state.iterations() * f->getEntities().size());
+}
+
+BENCHMARK(BM_FactoryJsonRoundTrip)->Apply(jsonFactorySizes);
+
+// the link reconnection part of from_json, builds the EntityIndex and visits every link of the factory
+static void BM_ReconnectLinks(benchmark::State &state) {
+    auto const f = Bench::syntheticFactory(state.range(0));
+    for (auto _: state) {
+        f->reconnectLinks();
+    }
+    state.SetItemsProcessed(state.iterations() * f->getEntities().size());
+}
+
+BENCHMARK(BM_ReconnectLinks)->Apply(jsonFactorySizes);
+
+// the save of the game state benchmarks, 40 factories of 10k entities
+static constexpr int SAVE_FACTORIES = 40;
+static constexpr long SAVE_FACTORY_ENTITIES = 10'000;
+
+static GameState syntheticSave() {
+    auto game = GameState();
+    for (int i = 0; i < SAVE_FACTORIES; i++) {
+        game.addFactory(Bench::syntheticFactory(SAVE_FACTORY_ENTITIES));
+    }
+    return game;
+}
+
+// the save loaded by 1 to 8 threads
+static void BM_GameStateFromJson(benchmark::State &state) {
+    auto const game = syntheticSave();
+    json const j = game;
+    auto pool = ThreadPool(state.range(0));
+    for (auto _: state) {
+        auto loaded = GameState::fromJson(j, pool);
+        benchmark::DoNotOptimize(loaded);
+    }
+    state.SetItemsProcessed(state.iterations() * SAVE_FACTORIES);
+}
+
+BENCHMARK(BM_GameStateFromJson)->RangeMultiplier(2)->Range(1, 8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// the JSON export of the save, as a document or streamed
+static void BM_GameStateToJsonDocument(benchmark::State &state) {
+    auto const game = syntheticSave();
+    for (auto _: state) {
+        auto out = std::ostringstream();
+        json const j = game;
+        out << j.dump();
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations() * SAVE_FACTORIES);
+}
+
+BENCHMARK(BM_GameStateToJsonDocument)->Unit(benchmark::kMillisecond);
+
+static void BM_GameStateToJsonStream(benchmark::State &state) {
+    auto const game = syntheticSave();
+    for (auto _: state) {
+        auto out = std::ostringstream();
+        writeJson(out, game);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations() * SAVE_FACTORIES);
+}
+
+BENCHMARK(BM_GameStateToJsonStream)->Unit(benchmark::kMillisecond);
+
+// opening a factory of the save that was stored for an hour
+static void BM_StoredFactoryLoad(benchmark::State &state) {
+    auto stored = StoredFactory::of(*Bench::syntheticFactory(SAVE_FACTORY_ENTITIES));
+    stored.advance(3600 * 1000L);
+    for (auto _: state) {
+        auto f = stored.load();
+        benchmark::DoNotOptimize(f);
+    }
+}
+
+BENCHMARK(BM_StoredFactoryLoad)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+
+#include "synthetic_factory.h"
+
+using namespace Fac;
+
+// factories from 100 to 1M entities
+static void factorySizes(benchmark::internal::Benchmark *b) {
+    b->RangeMultiplier(10)->Range(100, 1'000'000)->Unit(benchmark::kMillisecond);
+}
+
+// a factory that has run for a while, so the belts and buffers hold items
+static std::shared_ptr<Factory> runningFactory(long const entities) {
+    auto const f = Bench::syntheticFactory(entities);
+    f->advanceBy(10'000, [] {});
+    return f;
+}
+
+// one tick through Factory::update, which updates every entity and skips nothing
+static void BM_FactoryUpdate(benchmark::State &state) {
+    auto const f = runningFactory(state.range(0));
+    for (auto _: state) {
+        f->update(1);
+    }
+    state.SetItemsProcessed(state.iterations() * f->getEntities().size());
+}
+
+BENCHMARK(BM_FactoryUpdate)->Apply(factorySizes);
+
+// one simulated second, ticks in which everything sleeps are skipped
+static void BM_FactoryAdvanceBy(benchmark::State &state) {
+    auto const f = runningFactory(state.range(0));
+    for (auto _: state) {
+        f->advanceBy(1000, [] {});
+    }
+    state.SetItemsProcessed(state.iterations() * f->getEntities().size());
+}
+
+BENCHMARK(BM_FactoryAdvanceBy)->Apply(factorySizes);
+
+// updates every entity of one type of a running factory, without the scheduler
+template<typename T>
+static void BM_EntityUpdate(benchmark::State &state) {
+    auto const f = runningFactory(state.range(0));
+    auto const &entities = f->getEntityArray<T>();
+    for (auto _: state) {
+        for (auto const &e: entities) {
+            e->update(1);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * entities.size());
+}
+
+BENCHMARK_TEMPLATE(BM_EntityUpdate, Belt)->Apply(factorySizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_EntityUpdate, Splitter)->Apply(factorySizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_EntityUpdate, Merger)->Apply(factorySizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_EntityUpdate, Machine)->Apply(factorySizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_EntityUpdate, Storage)->Apply(factorySizes)->Unit(benchmark::kMicrosecond);
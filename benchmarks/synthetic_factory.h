@@ -0,0 +1,18 @@
+#ifndef SYNTHETIC_FACTORY_H
+#define SYNTHETIC_FACTORY_H
+
+#include <memory>
+
+#include "../src/factory.h"
+#include "../src/dsl/synthetic.h"
+
+namespace Bench {
+    // production chains of the recipe table with splitter and merger trees and mixed belt tiers
+    inline std::shared_ptr<Fac::Factory> syntheticFactory(long const entities) {
+        auto f = std::make_shared<Fac::Factory>();
+        SyntheticFactory::build(f, {.entities = entities});
+        return f;
+    }
+}
+
+#endif //SYNTHETIC_FACTORY_H
@@ -18,6 +18,9 @@
 #include "src/game/factory_overview.h"
 #include "src/game/factory_detail.h"
 #include "src/tools/gui.h"
+#include "src/tools/thread_pool.h"
+#include "src/game/simulation.h"
+#include "src/game/save.h"
 
 using namespace Fac;
 using json = nlohmann::json;
@@ -32,22 +35,14 @@ SDL_Renderer *renderer;
 
 void saveWorld() {
     std::cout << "Saving world\n";
-    auto current_save_file = std::ofstream(save_file);;
-    auto buffer = std::stringstream();
-
-    json j = gameState;
-    buffer << j.dump(4);
-    std::cout << buffer.str() << std::endl;
-    current_save_file << buffer.str() << std::endl;
-    current_save_file.flush();
-    current_save_file.close();
+    saveGameState(gameState, save_file);
     std::cout << "World saved\n";
 }
 
+// the world is saved when the main loop ends, after the simulation has stopped
 void signal_handler(int const signal) {
     stop = 1;
     std::cout << "Signal received: " << signal << std::endl;
-    saveWorld();
 }
 
 
@@ -124,13 +119,13 @@ int main(int argc, char *argv[]) {
     save_file = argv[1];
     std::cout << "Save file: " << save_file << std::endl;
 
-    // try to read the world as json from the safe file, if not continue
-    if (std::ifstream i(save_file); i) {
-        json j;
-        i >> j;
-        gameState = j.get<GameState>();
+    // loads the factories of the save, then runs their updates
+    auto const factory_pool = std::make_shared<ThreadPool>();
+
+    // try to read the world from the save file (binary or json), if not continue
+    if (std::ifstream(save_file).good()) {
+        gameState = loadGameStateLazily(save_file, *factory_pool);
         std::cout << "Loaded world from file\n";
-        i.close();
     } else {
         auto factory = std::make_shared<Factory>();
         gameState.addFactory(factory);
@@ -150,16 +145,20 @@ int main(int argc, char *argv[]) {
     constexpr auto clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
 
+    // the simulation runs on its own thread, the windows only read its snapshots
+    auto simulation = Simulation(gameState, factory_pool);
+    auto const autosave = std::make_shared<Autosave>(save_file);
+    simulation.setAutosave(autosave);
+
     auto navigation = Navigation();
     navigation.registerWindow(OVERVIEW, [&] {
-        auto view_model = FactoryOverviewWindowViewModel(gameState, navigation);
+        auto view_model = FactoryOverviewWindowViewModel(simulation, navigation);
         // copy viewmodel to the window to transport ownership, otherwise it would be removed at the end of the closure
         return std::make_unique<FactoryOverviewWindow>(view_model);
     });
 
     navigation.registerWindow(FACTORY_DETAIL, [&](int const id) {
-        auto const factory = gameState.getFactoryById(id);
-        auto view_model = FactoryDetailWindowViewModel{factory};
+        auto view_model = FactoryDetailWindowViewModel{simulation, id};
         return std::make_unique<FactoryDetailWindow>(view_model);
     });
 
@@ -167,6 +166,8 @@ int main(int argc, char *argv[]) {
 
     auto show_demo = false;
 
+    simulation.start();
+
     while (!stop) {
         auto const currentTime = Clock::now();
         std::chrono::duration<double> const elapsed = currentTime - startTime;
@@ -189,11 +190,6 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
-        // Factory logic
-        for (const auto &factory : gameState.getFactories()) {
-            factory->processWorldStep();
-        }
-
         // Start the Dear ImGui frame
         ImGui_ImplSDLRenderer3_NewFrame();
         ImGui_ImplSDL3_NewFrame();
@@ -304,6 +300,9 @@ int main(int argc, char *argv[]) {
     }
 
     // Cleanup
+    simulation.stop();
+    autosave->stop();
+
     ImGui_ImplSDLRenderer3_Shutdown();
     ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
@@ -1,10 +1,30 @@
 #ifndef RECIPES_H
 #define RECIPES_H
 
+#include <array>
 #include "resources.h"
 #include "../core.h"
 namespace Fac {
-inline Recipe recipe_IronIngot = {
+enum class RecipeId {
+	IronIngot,
+	IronPlate,
+	IronRod,
+	Cable,
+	Concrete,
+	CopperIngot,
+	ReinforcedIronPlate,
+	Screw,
+	CopperSheet,
+	ModularFrame,
+	Rotor,
+	SolidBiofuel,
+	AutomatedWiring,
+	EncasedIndustrialBeam,
+	Motor,
+	Stator,
+};
+constexpr std::size_t RECIPE_COUNT = 16;
+inline constexpr Recipe recipe_IronIngot = {
 	.inputs = {
 		{Resource::IronOre, 1},
 	},
@@ -13,7 +33,7 @@ inline Recipe recipe_IronIngot = {
 	},
 	.processing_time_s = 2
 };
-inline Recipe recipe_IronPlate = {
+inline constexpr Recipe recipe_IronPlate = {
 	.inputs = {
 		{Resource::IronIngot, 3},
 	},
@@ -22,7 +42,7 @@ inline Recipe recipe_IronPlate = {
 	},
 	.processing_time_s = 6
 };
-inline Recipe recipe_IronRod = {
+inline constexpr Recipe recipe_IronRod = {
 	.inputs = {
 		{Resource::IronIngot, 1},
 	},
@@ -31,7 +51,7 @@ inline Recipe recipe_IronRod = {
 	},
 	.processing_time_s = 4
 };
-inline Recipe recipe_Cable = {
+inline constexpr Recipe recipe_Cable = {
 	.inputs = {
 		{Resource::Wire, 2},
 	},
@@ -40,7 +60,7 @@ inline Recipe recipe_Cable = {
 	},
 	.processing_time_s = 2
 };
-inline Recipe recipe_Concrete = {
+inline constexpr Recipe recipe_Concrete = {
 	.inputs = {
 		{Resource::Limestone, 3},
 	},
@@ -49,7 +69,7 @@ inline Recipe recipe_Concrete = {
 	},
 	.processing_time_s = 4
 };
-inline Recipe recipe_CopperIngot = {
+inline constexpr Recipe recipe_CopperIngot = {
 	.inputs = {
 		{Resource::CopperOre, 1},
 	},
@@ -58,7 +78,7 @@ inline Recipe recipe_CopperIngot = {
 	},
 	.processing_time_s = 2
 };
-inline Recipe recipe_ReinforcedIronPlate = {
+inline constexpr Recipe recipe_ReinforcedIronPlate = {
 	.inputs = {
 		{Resource::IronPlate, 6},
 		{Resource::Screw, 12},
@@ -68,7 +88,7 @@ inline Recipe recipe_ReinforcedIronPlate = {
 	},
 	.processing_time_s = 12
 };
-inline Recipe recipe_Screw = {
+inline constexpr Recipe recipe_Screw = {
 	.inputs = {
 		{Resource::IronRod, 1},
 	},
@@ -77,7 +97,7 @@ inline Recipe recipe_Screw = {
 	},
 	.processing_time_s = 6
 };
-inline Recipe recipe_CopperSheet = {
+inline constexpr Recipe recipe_CopperSheet = {
 	.inputs = {
 		{Resource::CopperIngot, 2},
 	},
@@ -86,7 +106,7 @@ inline Recipe recipe_CopperSheet = {
 	},
 	.processing_time_s = 6
 };
-inline Recipe recipe_ModularFrame = {
+inline constexpr Recipe recipe_ModularFrame = {
 	.inputs = {
 		{Resource::ReinforcedIronPlate, 3},
 		{Resource::IronRod, 12},
@@ -96,7 +116,7 @@ inline Recipe recipe_ModularFrame = {
 	},
 	.processing_time_s = 60
 };
-inline Recipe recipe_Rotor = {
+inline constexpr Recipe recipe_Rotor = {
 	.inputs = {
 		{Resource::IronRod, 5},
 		{Resource::Screw, 25},
@@ -106,7 +126,7 @@ inline Recipe recipe_Rotor = {
 	},
 	.processing_time_s = 15
 };
-inline Recipe recipe_SolidBiofuel = {
+inline constexpr Recipe recipe_SolidBiofuel = {
 	.inputs = {
 		{Resource::Biomass, 8},
 	},
@@ -115,7 +135,7 @@ inline Recipe recipe_SolidBiofuel = {
 	},
 	.processing_time_s = 4
 };
-inline Recipe recipe_AutomatedWiring = {
+inline constexpr Recipe recipe_AutomatedWiring = {
 	.inputs = {
 		{Resource::Stator, 1},
 		{Resource::Cable, 20},
@@ -125,7 +145,7 @@ inline Recipe recipe_AutomatedWiring = {
 	},
 	.processing_time_s = 24
 };
-inline Recipe recipe_EncasedIndustrialBeam = {
+inline constexpr Recipe recipe_EncasedIndustrialBeam = {
 	.inputs = {
 		{Resource::SteelBeam, 3},
 		{Resource::Concrete, 6},
@@ -135,7 +155,7 @@ inline Recipe recipe_EncasedIndustrialBeam = {
 	},
 	.processing_time_s = 10
 };
-inline Recipe recipe_Motor = {
+inline constexpr Recipe recipe_Motor = {
 	.inputs = {
 		{Resource::Rotor, 2},
 		{Resource::Stator, 2},
@@ -145,7 +165,7 @@ inline Recipe recipe_Motor = {
 	},
 	.processing_time_s = 12
 };
-inline Recipe recipe_Stator = {
+inline constexpr Recipe recipe_Stator = {
 	.inputs = {
 		{Resource::SteelPipe, 3},
 		{Resource::Wire, 8},
@@ -155,5 +175,27 @@ inline Recipe recipe_Stator = {
 	},
 	.processing_time_s = 12
 };
+// all recipes, indexed by RecipeId
+inline constexpr std::array<Recipe, RECIPE_COUNT> RECIPES = {
+	recipe_IronIngot,
+	recipe_IronPlate,
+	recipe_IronRod,
+	recipe_Cable,
+	recipe_Concrete,
+	recipe_CopperIngot,
+	recipe_ReinforcedIronPlate,
+	recipe_Screw,
+	recipe_CopperSheet,
+	recipe_ModularFrame,
+	recipe_Rotor,
+	recipe_SolidBiofuel,
+	recipe_AutomatedWiring,
+	recipe_EncasedIndustrialBeam,
+	recipe_Motor,
+	recipe_Stator,
+};
+constexpr Recipe const &recipeById(RecipeId const id) {
+	return RECIPES[static_cast<std::size_t>(id)];
+}
 } // Fac
 #endif //RECIPES_H
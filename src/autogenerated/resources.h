@@ -1,6 +1,7 @@
 #ifndef RESOURCES_H
 #define RESOURCES_H
 
+#include <cstddef>
 #include <string_view>
 namespace Fac {
 enum class Resource {
@@ -35,6 +36,8 @@ enum class Resource {
 	Motor,
 	Coal,
 };
+// the number of resources, the values of Resource are 0 to RESOURCE_COUNT - 1
+constexpr std::size_t RESOURCE_COUNT = 30;
 constexpr std::string_view resourceToString(Resource const r) {
 	switch (r) {
 		case Resource::None:
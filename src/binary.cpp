@@ -0,0 +1,510 @@
+#include "binary.h"
+
+using namespace Fac;
+
+// the type tag an entity is stored with, the values must never change
+enum class BinaryEntityType : std::uint8_t {
+    Stack = 1,
+    ResourceNode = 2,
+    Extractor = 3,
+    Storage = 4,
+    Machine = 5,
+    Belt = 6,
+    Splitter = 7,
+    Merger = 8,
+};
+
+template<typename T>
+static constexpr BinaryEntityType binaryEntityType() {
+    if constexpr (std::is_same_v<T, Stack>) {
+        return BinaryEntityType::Stack;
+    } else if constexpr (std::is_same_v<T, ResourceNode>) {
+        return BinaryEntityType::ResourceNode;
+    } else if constexpr (std::is_same_v<T, Extractor>) {
+        return BinaryEntityType::Extractor;
+    } else if constexpr (std::is_same_v<T, Storage>) {
+        return BinaryEntityType::Storage;
+    } else if constexpr (std::is_same_v<T, Machine>) {
+        return BinaryEntityType::Machine;
+    } else if constexpr (std::is_same_v<T, Belt>) {
+        return BinaryEntityType::Belt;
+    } else if constexpr (std::is_same_v<T, Splitter>) {
+        return BinaryEntityType::Splitter;
+    } else if constexpr (std::is_same_v<T, Merger>) {
+        return BinaryEntityType::Merger;
+    } else {
+        static_assert(sizeof(T) == 0, "Unsupported entity type");
+    }
+}
+
+// found by the lookup from inside namespace Fac, unlike helpers in the global namespace
+namespace Fac {
+    namespace {
+        void to_binary(BinaryWriter &w, Resource const &r) {
+            w.write(static_cast<std::int32_t>(r));
+        }
+
+        // resources index arrays, a value outside of the enum is a corrupt save
+        Resource toResource(std::int32_t const value) {
+            if (value < 0 || value >= static_cast<std::int32_t>(RESOURCE_COUNT)) {
+                throw std::runtime_error("Unknown resource in binary save");
+            }
+            return static_cast<Resource>(value);
+        }
+
+        void from_binary(BinaryReader &b, Resource &r) {
+            r = toResource(b.read<std::int32_t>());
+        }
+
+        // vectors are written as a count followed by the elements
+        template<typename T>
+        void to_binary(BinaryWriter &w, std::vector<T> const &values) {
+            w.write(static_cast<std::uint32_t>(values.size()));
+            for (auto const &value: values) {
+                to_binary(w, value);
+            }
+        }
+
+        template<typename T>
+        void from_binary(BinaryReader &b, std::vector<T> &values) {
+            values.resize(b.read<std::uint32_t>());
+            for (auto &value: values) {
+                from_binary(b, value);
+            }
+        }
+
+        template<typename T>
+        void to_binary(BinaryWriter &w, std::vector<std::shared_ptr<T> > const &values) {
+            w.write(static_cast<std::uint32_t>(values.size()));
+            for (auto const &value: values) {
+                to_binary(w, *value);
+            }
+        }
+
+        template<typename T>
+        void from_binary(BinaryReader &b, std::vector<std::shared_ptr<T> > &values) {
+            values.resize(b.read<std::uint32_t>());
+            for (auto &value: values) {
+                value = std::make_shared<T>();
+                from_binary(b, *value);
+            }
+        }
+    }
+}
+
+void Fac::to_binary(BinaryWriter &w, const Recipe &r) {
+    w.write(static_cast<std::uint32_t>(r.inputs.size()));
+    for (auto const &[resource, amount]: r.inputs) {
+        to_binary(w, resource);
+        w.write(static_cast<std::int32_t>(amount));
+    }
+    w.write(static_cast<std::uint32_t>(r.products.size()));
+    for (auto const &[resource, amount]: r.products) {
+        to_binary(w, resource);
+        w.write(static_cast<std::int32_t>(amount));
+    }
+    w.write(static_cast<std::int32_t>(r.processing_time_s));
+}
+
+void Fac::from_binary(BinaryReader &b, Recipe &r) {
+    auto const inputs = b.read<std::uint32_t>();
+    if (inputs > Recipe::MAX_INGREDIENTS) {
+        throw std::runtime_error("Recipe with too many inputs in binary save");
+    }
+    r.inputs.resize(inputs);
+    for (auto &[resource, amount]: r.inputs) {
+        from_binary(b, resource);
+        amount = b.read<std::int32_t>();
+    }
+    auto const products = b.read<std::uint32_t>();
+    if (products > Recipe::MAX_INGREDIENTS) {
+        throw std::runtime_error("Recipe with too many products in binary save");
+    }
+    r.products.resize(products);
+    for (auto &[resource, amount]: r.products) {
+        from_binary(b, resource);
+        amount = b.read<std::int32_t>();
+    }
+    r.processing_time_s = b.read<std::int32_t>();
+}
+
+void Fac::to_binary(BinaryWriter &w, const Stack &r) {
+    w.write(static_cast<std::int32_t>(r._id));
+    w.write(static_cast<std::int32_t>(r._amount));
+    // -1 is a stack without a resource
+    w.write(static_cast<std::int32_t>(r.resource.has_value() ? static_cast<int>(r.resource.value()) : -1));
+    w.write(static_cast<std::int32_t>(r._max_stack_size));
+}
+
+void Fac::from_binary(BinaryReader &b, Stack &r) {
+    r._id = b.read<std::int32_t>();
+    r._amount = b.read<std::int32_t>();
+    auto const resource = b.read<std::int32_t>();
+    r.resource = resource == -1 ? std::nullopt : std::make_optional(toResource(resource));
+    r._max_stack_size = b.read<std::int32_t>();
+}
+
+void Fac::to_binary(BinaryWriter &w, const InputConnection &r) {
+    if (r.source.lock() == nullptr) {
+        w.write(std::uint8_t{0});
+        // in case of a broken link situation, save an empty stack
+        to_binary(w, r.isBrokenLink() || r.cachedStack == nullptr ? Stack() : *r.cachedStack);
+    } else {
+        w.write(std::uint8_t{1});
+        w.write(static_cast<std::int32_t>(r.sourceId));
+        w.write(static_cast<std::int32_t>(r.sourceOutputSlot));
+    }
+}
+
+void Fac::from_binary(BinaryReader &b, InputConnection &r) {
+    r.clear();
+    if (b.read<std::uint8_t>() == 0) {
+        r.cachedStack = std::make_shared<Stack>();
+        from_binary(b, *r.cachedStack);
+    } else {
+        r.sourceId = b.read<std::int32_t>();
+        r.sourceOutputSlot = b.read<std::int32_t>();
+    }
+}
+
+void Fac::to_binary(BinaryWriter &w, const BufferedConnection &r) {
+    to_binary(w, r._input_connections);
+    to_binary(w, r._output_stacks);
+}
+
+void Fac::from_binary(BinaryReader &b, BufferedConnection &r) {
+    from_binary(b, r._input_connections);
+    from_binary(b, r._output_stacks);
+    if (r._input_connections.size() != 1 || r._output_stacks.size() != 1) {
+        throw std::runtime_error("Machine input with the wrong number of stacks in binary save");
+    }
+}
+
+void Fac::to_binary(BinaryWriter &w, const ResourceNode &r) {
+    w.write(static_cast<std::int32_t>(r.getId()));
+    to_binary(w, r.getResource());
+    w.write(static_cast<std::int32_t>(r.getQuality()));
+    w.writeString(r.name);
+}
+
+void Fac::from_binary(BinaryReader &b, ResourceNode &r) {
+    r._id = b.read<std::int32_t>();
+    from_binary(b, r._resource);
+    auto const quality = b.read<std::int32_t>();
+    // the quality indexes the quality multipliers
+    if (quality < 0 || quality > static_cast<std::int32_t>(ResourceQuality::Impure)) {
+        throw std::runtime_error("Unknown resource quality in binary save");
+    }
+    r._quality = static_cast<ResourceQuality>(quality);
+    r.name = b.readString();
+}
+
+void Fac::to_binary(BinaryWriter &w, const Extractor &r) {
+    w.write(static_cast<std::int32_t>(r.getId()));
+    w.write(r.extraction_progress);
+    w.write(static_cast<std::uint8_t>(r.extracting));
+    w.write(static_cast<std::int32_t>(r._res_node_id));
+    w.write(static_cast<std::int32_t>(r._default_extraction_speed));
+    w.writeString(r.name);
+    to_binary(w, r._output_stacks);
+}
+
+void Fac::from_binary(BinaryReader &b, Extractor &r) {
+    r._id = b.read<std::int32_t>();
+    r.extraction_progress = b.read<double>();
+    r.extracting = b.read<std::uint8_t>() != 0;
+    r._res_node_id = b.read<std::int32_t>();
+    r._default_extraction_speed = b.read<std::int32_t>();
+    r.name = b.readString();
+    from_binary(b, r._output_stacks);
+}
+
+void Fac::to_binary(BinaryWriter &w, const Machine &r) {
+    w.write(static_cast<std::int32_t>(r.getId()));
+    w.write(static_cast<std::uint8_t>(r.processing));
+    w.write(r.processing_progress);
+    w.writeString(r.name);
+    w.write(static_cast<std::int32_t>(r._input_slots));
+    w.write(static_cast<std::int32_t>(r._output_slots));
+    w.write(static_cast<std::uint8_t>(r._active_recipe.has_value()));
+    if (r._active_recipe.has_value()) {
+        to_binary(w, r._active_recipe.value());
+    }
+    to_binary(w, r._input_connections);
+    to_binary(w, r._output_stacks);
+}
+
+void Fac::from_binary(BinaryReader &b, Machine &r) {
+    r._id = b.read<std::int32_t>();
+    r.processing = b.read<std::uint8_t>() != 0;
+    r.processing_progress = b.read<double>();
+    r.name = b.readString();
+    r._input_slots = b.read<std::int32_t>();
+    r._output_slots = b.read<std::int32_t>();
+    if (b.read<std::uint8_t>() != 0) {
+        Recipe recipe;
+        from_binary(b, recipe);
+        r._active_recipe = recipe;
+        r.prepareRecipe();
+    }
+    from_binary(b, r._input_connections);
+    from_binary(b, r._output_stacks);
+    // the updates index the stacks by slot without checks
+    if (r._input_slots < 1 || r._output_slots < 1 ||
+        r._input_connections.size() != static_cast<size_t>(r._input_slots) ||
+        r._output_stacks.size() != static_cast<size_t>(r._output_slots)) {
+        throw std::runtime_error("Machine slots do not match its stacks in binary save");
+    }
+    if (r._active_recipe.has_value() && (r._active_recipe->inputs.size() > static_cast<size_t>(r._input_slots) ||
+                                         r._active_recipe->products.size() > static_cast<size_t>(r._output_slots))) {
+        throw std::runtime_error("Machine recipe does not fit its slots in binary save");
+    }
+}
+
+// Belt, Splitter and Merger share the ItemMover part
+template<typename T>
+static void itemMoverToBinary(BinaryWriter &w, T const &r) {
+    w.write(static_cast<std::int32_t>(r.getId()));
+    w.write(r.getItemsPerSecond());
+    w.write(static_cast<std::uint8_t>(r.getActive()));
+    w.write(static_cast<std::uint8_t>(r.getJammed()));
+    w.writeString(r.name);
+}
+
+// times are saved relative to the belt time, like in the JSON saves
+void Fac::to_binary(BinaryWriter &w, const Belt &r) {
+    itemMoverToBinary(w, r);
+    w.write(static_cast<std::int32_t>(r.getLength()));
+    w.write(static_cast<std::int32_t>(r._lane_count));
+    for (int i = 0; i < r._lane_count; i++) {
+        auto const &item = r._lane[(r._lane_head + i) % r.getLength()];
+        to_binary(w, item.resource);
+        w.write(r._clock - item.entered);
+    }
+    w.write(std::max(0.0, r._next_entry - r._clock));
+    w.write(std::max(0.0, r._next_exit - r._clock));
+    to_binary(w, r._input_connections);
+    to_binary(w, r._output_stacks);
+}
+
+void Fac::from_binary(BinaryReader &b, Belt &r) {
+    r._id = b.read<std::int32_t>();
+    r._items_per_s = b.read<double>();
+    r._active = b.read<std::uint8_t>() != 0;
+    r._jammed = b.read<std::uint8_t>() != 0;
+    r.name = b.readString();
+    r._clock = 0;
+    auto const length = b.read<std::int32_t>();
+    if (length < 1) {
+        throw std::runtime_error("A belt needs a length of at least 1");
+    }
+    r._lane.assign(length, {});
+    r._lane_head = 0;
+    r._lane_count = 0;
+    auto const items = b.read<std::int32_t>();
+    if (items > r.getLength()) {
+        throw std::runtime_error("More items than room on a belt");
+    }
+    for (int i = 0; i < items; i++) {
+        Resource resource;
+        from_binary(b, resource);
+        r.push(resource);
+        r._lane[i].entered = -b.read<double>();
+    }
+    r._next_entry = b.read<double>();
+    r._next_exit = b.read<double>();
+    from_binary(b, r._input_connections);
+    from_binary(b, r._output_stacks);
+}
+
+void Fac::to_binary(BinaryWriter &w, const Splitter &r) {
+    itemMoverToBinary(w, r);
+    to_binary(w, r._in_transit_stack);
+    w.write(r._time_to_next_transfer);
+    w.write(static_cast<std::uint8_t>(r.split_to_first_output));
+    to_binary(w, r._input_connections);
+    to_binary(w, r._output_stacks);
+}
+
+void Fac::from_binary(BinaryReader &b, Splitter &r) {
+    r._id = b.read<std::int32_t>();
+    r._items_per_s = b.read<double>();
+    r._active = b.read<std::uint8_t>() != 0;
+    r._jammed = b.read<std::uint8_t>() != 0;
+    r.name = b.readString();
+    from_binary(b, r._in_transit_stack);
+    r._time_to_next_transfer = b.read<double>();
+    r.split_to_first_output = b.read<std::uint8_t>() != 0;
+    from_binary(b, r._input_connections);
+    from_binary(b, r._output_stacks);
+}
+
+void Fac::to_binary(BinaryWriter &w, const Merger &r) {
+    itemMoverToBinary(w, r);
+    to_binary(w, r._in_transit_stack);
+    w.write(r._time_to_next_transfer);
+    w.write(static_cast<std::uint8_t>(r.merge_from_first_input));
+    to_binary(w, r._input_connections);
+    to_binary(w, r._output_stacks);
+}
+
+void Fac::from_binary(BinaryReader &b, Merger &r) {
+    r._id = b.read<std::int32_t>();
+    r._items_per_s = b.read<double>();
+    r._active = b.read<std::uint8_t>() != 0;
+    r._jammed = b.read<std::uint8_t>() != 0;
+    r.name = b.readString();
+    from_binary(b, r._in_transit_stack);
+    r._time_to_next_transfer = b.read<double>();
+    r.merge_from_first_input = b.read<std::uint8_t>() != 0;
+    from_binary(b, r._input_connections);
+    from_binary(b, r._output_stacks);
+}
+
+void Fac::to_binary(BinaryWriter &w, const Storage &r) {
+    w.write(static_cast<std::int32_t>(r.getId()));
+    w.write(static_cast<std::int32_t>(r._max_item_stacks));
+    w.writeString(r.name);
+    to_binary(w, r._input_connections);
+    to_binary(w, r._output_stacks);
+    to_binary(w, r._content_stacks);
+}
+
+void Fac::from_binary(BinaryReader &b, Storage &r) {
+    r._id = b.read<std::int32_t>();
+    r._max_item_stacks = b.read<std::int32_t>();
+    r.name = b.readString();
+    from_binary(b, r._input_connections);
+    from_binary(b, r._output_stacks);
+    from_binary(b, r._content_stacks);
+    r.reindex();
+}
+
+void Fac::to_binary(BinaryWriter &w, const Factory &r) {
+    writeFactory(w, r);
+}
+
+std::vector<BinaryEntityRange> Fac::writeFactory(BinaryWriter &w, const Factory &r) {
+    std::vector<BinaryEntityRange> ranges;
+    ranges.reserve(r._entities.size());
+    w.write(static_cast<std::int32_t>(r.getId()));
+    w.write(static_cast<std::uint32_t>(r._entities.size()));
+    r._entities.forEachArray([&]<typename T>(std::vector<std::shared_ptr<T> > const &array) {
+        for (auto const &entity: array) {
+            auto const begin = w.data().size();
+            w.write(binaryEntityType<T>());
+            to_binary(w, *entity);
+            ranges.push_back({entity->getId(), begin, w.data().size()});
+        }
+    });
+    return ranges;
+}
+
+template<typename T, typename F>
+static void readEntity(BinaryReader &b, F const &fn) {
+    auto const entity = std::make_shared<T>();
+    from_binary(b, *entity);
+    fn(entity);
+}
+
+// reads the entity type and the entity, calls fn with the entity
+template<typename F>
+static void readEntity(BinaryReader &b, F const &fn) {
+    switch (b.read<BinaryEntityType>()) {
+        case BinaryEntityType::Stack:
+            readEntity<Stack>(b, fn);
+            break;
+        case BinaryEntityType::ResourceNode:
+            readEntity<ResourceNode>(b, fn);
+            break;
+        case BinaryEntityType::Extractor:
+            readEntity<Extractor>(b, fn);
+            break;
+        case BinaryEntityType::Storage:
+            readEntity<Storage>(b, fn);
+            break;
+        case BinaryEntityType::Machine:
+            readEntity<Machine>(b, fn);
+            break;
+        case BinaryEntityType::Belt:
+            readEntity<Belt>(b, fn);
+            break;
+        case BinaryEntityType::Splitter:
+            readEntity<Splitter>(b, fn);
+            break;
+        case BinaryEntityType::Merger:
+            readEntity<Merger>(b, fn);
+            break;
+        default:
+            throw std::runtime_error("Unknown entity type in binary save");
+    }
+}
+
+void Fac::from_binary(BinaryReader &b, Factory &r) {
+    r.clearWorld();
+    r.id = b.read<std::int32_t>();
+
+    auto const count = b.read<std::uint32_t>();
+    for (std::uint32_t i = 0; i < count; i++) {
+        readEntity(b, [&r](auto const &entity) { r.addEntity(entity); });
+    }
+
+    r.reconnectLinks();
+}
+
+std::pair<int, std::vector<BinaryEntityRange> > Fac::readEntityRanges(std::span<char const> const data) {
+    auto b = BinaryReader(data);
+    auto const id = b.read<std::int32_t>();
+    auto const count = b.read<std::uint32_t>();
+    std::vector<BinaryEntityRange> ranges;
+    ranges.reserve(count);
+    for (std::uint32_t i = 0; i < count; i++) {
+        auto const begin = b.getPosition();
+        auto entity_id = 0;
+        readEntity(b, [&entity_id](auto const &entity) { entity_id = entity->getId(); });
+        ranges.push_back({entity_id, begin, b.getPosition()});
+    }
+    return {id, ranges};
+}
+
+// V is the type the values are stored as
+template<typename V, typename T>
+static void resourceArrayToBinary(BinaryWriter &w, ResourceArray<T> const &r) {
+    auto const resources = std::ranges::count_if(r, [](T const value) { return value != 0; });
+    w.write(static_cast<std::uint32_t>(resources));
+    r.forEach([&w](Resource const resource, T const value) {
+        if (value != 0) {
+            w.write(static_cast<std::int32_t>(resource));
+            w.write(static_cast<V>(value));
+        }
+    });
+}
+
+template<typename V, typename T>
+static void resourceArrayFromBinary(BinaryReader &b, ResourceArray<T> &r) {
+    r = {};
+    auto const resources = b.read<std::uint32_t>();
+    for (std::uint32_t i = 0; i < resources; i++) {
+        auto const resource = b.read<std::int32_t>();
+        auto const value = b.read<V>();
+        if (resource >= 0 && resource < RESOURCE_COUNT) {
+            r[static_cast<Resource>(resource)] = static_cast<T>(value);
+        }
+    }
+}
+
+void Fac::to_binary(BinaryWriter &w, const Inventory &r) {
+    resourceArrayToBinary<std::int32_t>(w, r);
+}
+
+void Fac::from_binary(BinaryReader &b, Inventory &r) {
+    resourceArrayFromBinary<std::int32_t>(b, r);
+}
+
+void Fac::to_binary(BinaryWriter &w, const ResourceArray<double> &r) {
+    resourceArrayToBinary<double>(w, r);
+}
+
+void Fac::from_binary(BinaryReader &b, ResourceArray<double> &r) {
+    resourceArrayFromBinary<double>(b, r);
+}
@@ -0,0 +1,188 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "factory.h"
+
+namespace Fac {
+    static_assert(std::endian::native == std::endian::little, "The binary save format is little endian");
+
+    /**
+     * Binary save format
+     * ------------------
+     * A compact alternative to the JSON saves. Values are written in their little endian memory
+     * representation without any padding, a save starts with BINARY_MAGIC and BINARY_VERSION.
+     * Reading works directly on the bytes of a (memory mapped) file, nothing is parsed up front.
+     * Version 3 stores every factory of a game state as a chunk with its size, see StoredFactory.
+     */
+    static constexpr std::string_view BINARY_MAGIC = "FACSAVE";
+    static constexpr std::uint32_t BINARY_VERSION = 3;
+
+    class BinaryWriter {
+    public:
+        template<typename T>
+            requires std::is_trivially_copyable_v<T>
+        void write(T const &value) {
+            auto const offset = _data.size();
+            _data.resize(offset + sizeof(T));
+            std::memcpy(_data.data() + offset, &value, sizeof(T));
+        }
+
+        void writeString(std::string_view const value) {
+            write(static_cast<std::uint32_t>(value.size()));
+            _data.insert(_data.end(), value.begin(), value.end());
+        }
+
+        void writeBytes(std::span<char const> const bytes) {
+            _data.insert(_data.end(), bytes.begin(), bytes.end());
+        }
+
+        void writeHeader() {
+            _data.insert(_data.end(), BINARY_MAGIC.begin(), BINARY_MAGIC.end());
+            write(BINARY_VERSION);
+        }
+
+        [[nodiscard]] std::vector<char> const &data() const { return _data; }
+
+    private:
+        std::vector<char> _data;
+    };
+
+    class BinaryReader {
+    public:
+        explicit BinaryReader(std::span<char const> const data): _data(data) {
+        }
+
+        template<typename T>
+            requires std::is_trivially_copyable_v<T>
+        T read() {
+            T value;
+            std::memcpy(&value, take(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        std::string readString() {
+            auto const size = read<std::uint32_t>();
+            return {take(size), size};
+        }
+
+        // the next bytes, without copying them
+        std::span<char const> readBytes(size_t const size) {
+            return {take(size), size};
+        }
+
+        // throws if the data is not a binary save of a supported version
+        void readHeader() {
+            if (_data.size() < BINARY_MAGIC.size() ||
+                std::string_view(_data.data(), BINARY_MAGIC.size()) != BINARY_MAGIC) {
+                throw std::runtime_error("Not a binary save");
+            }
+            take(BINARY_MAGIC.size());
+            if (auto const version = read<std::uint32_t>(); version != BINARY_VERSION) {
+                throw std::runtime_error("Unsupported binary save version " + std::to_string(version));
+            }
+        }
+
+        [[nodiscard]] bool atEnd() const { return _position == _data.size(); }
+
+        [[nodiscard]] size_t getPosition() const { return _position; }
+
+    private:
+        char const *take(size_t const size) {
+            if (_data.size() - _position < size) {
+                throw std::runtime_error("Unexpected end of binary save");
+            }
+            auto const result = _data.data() + _position;
+            _position += size;
+            return result;
+        }
+
+        std::span<char const> _data;
+        size_t _position = 0;
+    };
+
+    [[nodiscard]] inline bool isBinarySave(std::span<char const> const data) {
+        return data.size() >= BINARY_MAGIC.size() && std::string_view(data.data(), BINARY_MAGIC.size()) == BINARY_MAGIC;
+    }
+
+    void to_binary(BinaryWriter &w, const Recipe &r);
+
+    void from_binary(BinaryReader &b, Recipe &r);
+
+    void to_binary(BinaryWriter &w, const Stack &r);
+
+    void from_binary(BinaryReader &b, Stack &r);
+
+    void to_binary(BinaryWriter &w, const InputConnection &r);
+
+    void from_binary(BinaryReader &b, InputConnection &r);
+
+    void to_binary(BinaryWriter &w, const BufferedConnection &r);
+
+    void from_binary(BinaryReader &b, BufferedConnection &r);
+
+    void to_binary(BinaryWriter &w, const ResourceNode &r);
+
+    void from_binary(BinaryReader &b, ResourceNode &r);
+
+    void to_binary(BinaryWriter &w, const Extractor &r);
+
+    void from_binary(BinaryReader &b, Extractor &r);
+
+    void to_binary(BinaryWriter &w, const Machine &r);
+
+    void from_binary(BinaryReader &b, Machine &r);
+
+    void to_binary(BinaryWriter &w, const Belt &r);
+
+    void from_binary(BinaryReader &b, Belt &r);
+
+    void to_binary(BinaryWriter &w, const Splitter &r);
+
+    void from_binary(BinaryReader &b, Splitter &r);
+
+    void to_binary(BinaryWriter &w, const Merger &r);
+
+    void from_binary(BinaryReader &b, Merger &r);
+
+    void to_binary(BinaryWriter &w, const Storage &r);
+
+    void from_binary(BinaryReader &b, Storage &r);
+
+    void to_binary(BinaryWriter &w, const Factory &r);
+
+    void from_binary(BinaryReader &b, Factory &r);
+
+    // as (resource, value) pairs of the resources with a value that is not zero
+    void to_binary(BinaryWriter &w, const Inventory &r);
+
+    void from_binary(BinaryReader &b, Inventory &r);
+
+    void to_binary(BinaryWriter &w, const ResourceArray<double> &r);
+
+    void from_binary(BinaryReader &b, ResourceArray<double> &r);
+
+    // where one entity is in the data of an encoded factory, from its entity type to its last byte
+    struct BinaryEntityRange {
+        int id;
+        size_t begin;
+        size_t end;
+    };
+
+    // writes the factory like to_binary, returns the range of every entity in the data of w
+    std::vector<BinaryEntityRange> writeFactory(BinaryWriter &w, const Factory &r);
+
+    // the id and the entity ranges of factory data written by to_binary, every entity is read
+    // to find its end but the factory is not built
+    std::pair<int, std::vector<BinaryEntityRange> > readEntityRanges(std::span<char const> data);
+}
+
+#endif //BINARY_H
@@ -8,11 +8,15 @@ static int _calculate_ppm(std::optional<int> const processing_time, std::optiona
 }
 
 void Machine::setRecipe(std::optional<Recipe> const &r) {
-    if (r->inputs.size() > _input_slots || r->products.size() > _output_slots) {
+    if (r.has_value() && (r->inputs.size() > _input_slots || r->products.size() > _output_slots)) {
         throw std::runtime_error("Recipe does not fit in this machine");
     }
 
     _active_recipe = r;
+    prepareRecipe();
+    if (!r.has_value()) {
+        return;
+    }
 
     // Note: the order of inputs in the recipe determines the slot they are added to
     for (int i = 0; i < r->inputs.size(); i++) {
@@ -29,33 +33,28 @@ void Machine::setRecipe(std::optional<Recipe> const &r) {
     }
 }
 
-std::optional<Recipe> Machine::getRecipe() const {
-    return _active_recipe;
-}
-
-int Machine::getInputRpm() const {
+static int _average_ppm(int const processing_time_s, FixedVector<Recipe::Ingredient, Recipe::MAX_INGREDIENTS> const &ingredients) {
+    if (ingredients.empty()) {
+        return 0;
+    }
     auto ppm = 0.0;
-    if (_active_recipe.has_value()) {
-        auto const r = _active_recipe.value();
-        for (int i = 0; i < r.inputs.size(); i++) {
-            ppm += _calculate_ppm(r.processing_time_s, r.inputs[i].amount);
-        }
-        ppm = ppm / r.inputs.size();
+    for (auto const &ingredient: ingredients) {
+        ppm += _calculate_ppm(processing_time_s, ingredient.amount);
     }
-    return ppm;
+    return ppm / ingredients.size();
 }
 
-// TODO this is a copy of getInputRpm
-int Machine::getOutputRpm() const {
-    auto ppm = 0.0;
-    if (_active_recipe.has_value()) {
-        auto const r = _active_recipe.value();
-        for (int i = 0; i < r.products.size(); i++) {
-            ppm += _calculate_ppm(r.processing_time_s, r.products[i].amount);
-        }
-        ppm = ppm / r.products.size();
+void Machine::prepareRecipe() {
+    if (!_active_recipe.has_value()) {
+        _processing_time_ms = 0;
+        _input_rpm = 0;
+        _output_rpm = 0;
+        return;
     }
-    return ppm;
+    auto const &r = *_active_recipe;
+    _processing_time_ms = r.processing_time_s * 1000;
+    _input_rpm = _average_ppm(r.processing_time_s, r.inputs);
+    _output_rpm = _average_ppm(r.processing_time_s, r.products);
 }
 
 void Machine::update(double const dt) {
@@ -64,29 +63,26 @@ void Machine::update(double const dt) {
     }
 
     std::ranges::for_each(_input_connections, [](auto &c) {
-        auto const input = c.getInputStack(0);
-        auto const buffer = c.getOutputStack(0);
-        while (!input->isEmpty() && buffer->canAdd(1, input->getResource())) {
-            buffer->addOne(input->getResource());
-            input->removeOne();
-        }
+        c.inputStack(0).transferTo(c.outputStack(0));
     });
 
     if (processing) {
         processing_progress += dt;
     }
 
-    const auto [inputs, products, processing_time_s] = _active_recipe.value();
+    auto const &inputs = _active_recipe->inputs;
+    auto const &products = _active_recipe->products;
 
-    if (processing_progress >= processing_time_s * 1000) {
+    if (processing_progress >= _processing_time_ms) {
         processing = false;
         processing_progress = 0.0;
         for (int i = 0; i < products.size(); i++) {
-            if (auto const stack = getOutputStack(i); stack->isFull()) {
+            if (auto &stack = outputStack(i); stack.isFull()) {
                 // TODO what to do when output stack is full?
                 // Idea: keep in a processing and add to output stack when it becomes available
             } else {
-                stack->addAmount(products[i].amount, products[i].resource);
+                stack.addAmount(products[i].amount, products[i].resource);
+                _produced_amounts[products[i].resource] += products[i].amount;
             }
 
         }
@@ -95,7 +91,7 @@ void Machine::update(double const dt) {
 
     if (!processing && canStartProduction()) {
         for (int i = 0; i < inputs.size(); i++) {
-            getInputStack(i)->removeAmount(inputs[i].amount);
+            inputStack(i).removeAmount(inputs[i].amount);
         }
         processing_progress = 0.0;
         processing = true;
@@ -104,6 +100,39 @@ void Machine::update(double const dt) {
 
 }
 
+double Machine::getSleepTime() const {
+    if (!_active_recipe.has_value()) {
+        return SLEEP_FOREVER;
+    }
+
+    if (_processing_time_ms == 0 || processing_progress >= _processing_time_ms) {
+        return 0;
+    }
+
+    // items waiting to be moved into the buffers are moved with the next update
+    for (auto const &c: _input_connections) {
+        auto const &input = c.inputStack(0);
+        if (!input.isEmpty() && c.outputStack(0).canAdd(1, input.getResource())) {
+            return 0;
+        }
+    }
+
+    if (processing) {
+        return _processing_time_ms - processing_progress;
+    }
+    return canStartProduction() ? 0 : SLEEP_FOREVER;
+}
+
+void Machine::watchStacks(std::shared_ptr<SleepState> const &state) const {
+    for (auto const &c: _input_connections) {
+        c.inputStack(0).addSleeper(state);
+        c.outputStack(0).addSleeper(state);
+    }
+    for (auto const &output_stack: _output_stacks) {
+        output_stack->addSleeper(state);
+    }
+}
+
 bool Machine::canStartProduction() const {
     if (processing)
         return false;
@@ -111,65 +140,102 @@ bool Machine::canStartProduction() const {
     if (!_active_recipe.has_value())
         return false;
 
-    auto const r = _active_recipe.value();
-    if (r.processing_time_s == 0)
+    auto const &r = *_active_recipe;
+    if (_processing_time_ms == 0)
         return false;
 
     for (int i = 0; i < r.inputs.size(); i++) {
-        if (getInputStack(i)->getAmount() < r.inputs[i].amount)
+        if (inputStack(i).getAmount() < r.inputs[i].amount)
             return false;
     }
 
     for (int i = 0; i < r.products.size(); i++) {
-        if (!getOutputStack(i)->canAdd(r.products[i].amount, r.products[i].resource))
+        if (!outputStack(i).canAdd(r.products[i].amount, r.products[i].resource))
             return false;
     }
 
-    if (getOutputStack(0)->isFull())
+    if (outputStack(0).isFull())
         return false;
 
     return true;
 }
 
 
-void Belt::update(double dt) {
-    // Transfer items from one machine to another
-    // if the from machine has items to give and the to machine has space to receive
+void Belt::setLength(int const length) {
+    if (length < 1) {
+        throw std::runtime_error("A belt needs a length of at least 1");
+    }
+    auto const items = getItems();
+    _lane.assign(length, {});
+    _lane_head = 0;
+    _lane_count = 0;
+    for (auto const &item: items) {
+        if (_lane_count < length) {
+            push(item);
+        }
+    }
+    _active = _lane_count > 0;
+}
 
-    // it takes an item from the 'from' machine at the beginning of the transfer
-    // and adds it to the 'to' machine at the end of the transfer
+std::vector<Resource> Belt::getItems() const {
+    std::vector<Resource> items;
+    for (int i = 0; i < _lane_count; i++) {
+        items.push_back(_lane[(_lane_head + i) % getLength()].resource);
+    }
+    return items;
+}
 
+void Belt::push(Resource const resource) {
+    _lane[(_lane_head + _lane_count) % getLength()] = {resource, _clock};
+    _lane_count++;
+}
 
-    if (!_active && !getInputStack(0)->isEmpty() && _in_transit_stack.empty()) {
-        _active = true;
-        _in_transit_stack.push_back(getInputStack(0)->getResource());
-        _time_to_next_transfer = 0.0;
-        getInputStack(0)->removeOne();
-        return;
-    }
+void Belt::pop() {
+    _lane_head = (_lane_head + 1) % getLength();
+    _lane_count--;
+}
 
-    if (_active && !_in_transit_stack.empty()) {
-        _time_to_next_transfer += dt;
-        if (_time_to_next_transfer >= 1000 / _items_per_s) {
-            _time_to_next_transfer = 0.0;
-            if (getOutputStack(0)->canAdd(1, _in_transit_stack[0])) {
-                // TODO if output stack resource is not set, we should set it here
-                getOutputStack(0)->addOne(_in_transit_stack[0]);
-                _in_transit_stack.pop_back();
-                _jammed = false;
-            } else {
-                _jammed = true;
-            }
-            _active = false;
+void Belt::update(double const dt) {
+    _clock += dt;
+
+    // the front item leaves as soon as it reached the end and the output has room
+    if (_lane_count > 0 && getFrontExitTime() <= _clock) {
+        auto const resource = _lane[_lane_head].resource;
+        if (auto &output = outputStack(0); output.canAdd(1, resource)) {
+            output.addOne(resource);
+            pop();
+            _next_exit = _clock + getSpacing();
+            _jammed = false;
+        } else {
+            _jammed = true;
         }
-        return;
     }
 
-    // try to unjam
-    if (_jammed || (!_active && !_in_transit_stack.empty())) {
-        _time_to_next_transfer = 0.0;
-        _active = true;
+    // a new item enters when there is room and the previous item moved far enough
+    if (auto &input = inputStack(0); _lane_count < getLength() && _next_entry <= _clock && !input.isEmpty()) {
+        push(input.getResource());
+        input.removeOne();
+        _next_entry = _clock + getSpacing();
+    }
+
+    _active = _lane_count > 0;
+}
+
+double Belt::getSleepTime() const {
+    auto sleep_time = SLEEP_FOREVER;
+    // a jammed belt waits for its output to change
+    if (_lane_count > 0 && !_jammed) {
+        sleep_time = std::max(0.0, getFrontExitTime() - _clock);
+    }
+    if (_lane_count < getLength() && !inputStack(0).isEmpty()) {
+        sleep_time = std::min(sleep_time, std::max(0.0, _next_entry - _clock));
     }
+    return sleep_time;
+}
+
+void Belt::watchStacks(std::shared_ptr<SleepState> const &state) const {
+    inputStack(0).addSleeper(state);
+    outputStack(0).addSleeper(state);
 }
 
 void Splitter::update(double dt) {
@@ -179,16 +245,16 @@ void Splitter::update(double dt) {
 
     auto add_to_stack = [this](int const slot_nr) {
         _in_transit_stack.pop_back();
-        getOutputStack(slot_nr)->addOne(_in_transit_stack[0]);
+        outputStack(slot_nr).addOne(_in_transit_stack[0]);
         _jammed = false;
         split_to_first_output = !split_to_first_output;
     };
 
     // TODO this block is a copy from belt!
-    if (!_active && !getInputStack(0)->isEmpty() && _in_transit_stack.empty()) {
+    if (!_active && !inputStack(0).isEmpty() && _in_transit_stack.empty()) {
         _active = true;
-        _in_transit_stack.push_back(getInputStack(0)->getResource());
-        getInputStack(0)->removeOne();
+        _in_transit_stack.push_back(inputStack(0).getResource());
+        inputStack(0).removeOne();
         _time_to_next_transfer = 0.0;
         return;
     }
@@ -198,8 +264,8 @@ void Splitter::update(double dt) {
         if (_time_to_next_transfer >= 1000 / _items_per_s) {
             _time_to_next_transfer = 0.0;
 
-            auto const can_add_to_first = getOutputStack(0)->canAdd(1, _in_transit_stack[0]);
-            auto const can_add_to_second = getOutputStack(1)->canAdd(1, _in_transit_stack[0]);
+            auto const can_add_to_first = outputStack(0).canAdd(1, _in_transit_stack[0]);
+            auto const can_add_to_second = outputStack(1).canAdd(1, _in_transit_stack[0]);
 
             if (split_to_first_output) {
                 if (can_add_to_first) {
@@ -230,34 +296,45 @@ void Splitter::update(double dt) {
     }
 }
 
+double Splitter::getSleepTime() const {
+    if (!_active && !_jammed && _in_transit_stack.empty()) {
+        return inputStack(0).isEmpty() ? SLEEP_FOREVER : 0;
+    }
+    return getTransferSleepTime();
+}
+
+void Splitter::watchStacks(std::shared_ptr<SleepState> const &state) const {
+    inputStack(0).addSleeper(state);
+}
+
 void Merger::update(double dt) {
     if (!_active &&  _in_transit_stack.empty()) {
 
-        auto const ip0 = getInputStack(0);
-        auto const ip1 = getInputStack(1);
+        auto &ip0 = inputStack(0);
+        auto &ip1 = inputStack(1);
 
-        if (ip0->isEmpty() && ip1->isEmpty()) {
+        if (ip0.isEmpty() && ip1.isEmpty()) {
             return;
         }
         if (merge_from_first_input) {
-            if (ip0->isEmpty()) {
+            if (ip0.isEmpty()) {
                 merge_from_first_input = false;
                 return;
             } else {
-                _in_transit_stack.push_back(ip0->getResource());
-                ip0->removeOne();
+                _in_transit_stack.push_back(ip0.getResource());
+                ip0.removeOne();
                 merge_from_first_input = false;
                 _active = true;
                 _time_to_next_transfer = 0.0;
                 return;
             }
         } else {
-            if (ip1->isEmpty()) {
+            if (ip1.isEmpty()) {
                 merge_from_first_input = true;
                 return;
             } else {
-                _in_transit_stack.push_back(ip1->getResource());
-                ip1->removeOne();
+                _in_transit_stack.push_back(ip1.getResource());
+                ip1.removeOne();
                 merge_from_first_input = true;
                 _active = true;
                 _time_to_next_transfer = 0.0;
@@ -271,8 +348,8 @@ void Merger::update(double dt) {
         _time_to_next_transfer += dt;
         if (_time_to_next_transfer >= 1000 / _items_per_s) {
             _time_to_next_transfer = 0.0;
-            if (getOutputStack(0)->canAdd(1, _in_transit_stack[0])) {
-                getOutputStack(0)->addOne(_in_transit_stack[0]);
+            if (outputStack(0).canAdd(1, _in_transit_stack[0])) {
+                outputStack(0).addOne(_in_transit_stack[0]);
                 _in_transit_stack.pop_back();
                 _jammed = false;
             } else {
@@ -290,6 +367,18 @@ void Merger::update(double dt) {
     }
 }
 
+double Merger::getSleepTime() const {
+    if (!_active && _in_transit_stack.empty()) {
+        return inputStack(0).isEmpty() && inputStack(1).isEmpty() ? SLEEP_FOREVER : 0;
+    }
+    return getTransferSleepTime();
+}
+
+void Merger::watchStacks(std::shared_ptr<SleepState> const &state) const {
+    inputStack(0).addSleeper(state);
+    inputStack(1).addSleeper(state);
+}
+
 void Extractor::update(double const dt) {
     if (_res_node->getResource() == Resource::None) {
         return;
@@ -301,7 +390,7 @@ void Extractor::update(double const dt) {
 
     if (!extracting) {
         // can we start extracting?
-        if (getOutputStack(0)->getAmount() < MAX_STACK_SIZE) {
+        if (outputStack(0).getAmount() < MAX_STACK_SIZE) {
             extracting = true;
         }
         extraction_progress = 0.0;
@@ -309,9 +398,30 @@ void Extractor::update(double const dt) {
     }
 
     if (extracting && extraction_progress >= 60 * 1000 / _extraction_speed) {
-        getOutputStack(0)->addOne(_res_node->getResource());
+        outputStack(0).addOne(_res_node->getResource());
+        _extracted_amount++;
         extraction_progress = 0.0;
         extracting = false;
         return;
     }
 }
+
+double Extractor::getSleepTime() const {
+    if (_res_node->getResource() == Resource::None) {
+        return SLEEP_FOREVER;
+    }
+
+    if (extracting) {
+        return std::max(0.0, 60 * 1000 / _extraction_speed - extraction_progress);
+    }
+
+    // a full output stack stops the extraction until items are taken away
+    if (outputStack(0).getAmount() >= MAX_STACK_SIZE && extraction_progress == 0.0) {
+        return SLEEP_FOREVER;
+    }
+    return 0;
+}
+
+void Extractor::watchStacks(std::shared_ptr<SleepState> const &state) const {
+    outputStack(0).addSleeper(state);
+}
@@ -1,10 +1,14 @@
 #ifndef CORE_H
 #define CORE_H
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <vector>
 #include <nlohmann/json.hpp>
 #include "autogenerated/resources.h"
+#include "inventory.h"
 #include "serialization.h"
 
 using json = nlohmann::json;
@@ -30,10 +34,11 @@ namespace Fac {
         return "Unknown";
     }
 
-    std::map<ResourceQuality, float> const resource_quality_multiplier = {
-        {ResourceQuality::Normal, 1.0},
-        {ResourceQuality::Pure, 2.0},
-        {ResourceQuality::Impure, 0.5},
+    // indexed by ResourceQuality
+    constexpr std::array<float, 3> resource_quality_multiplier = {
+        1.0, // Normal
+        2.0, // Pure
+        0.5, // Impure
     };
 
     struct Recipe {
@@ -43,41 +48,122 @@ namespace Fac {
             NLOHMANN_DEFINE_TYPE_INTRUSIVE(Ingredient, resource, amount)
         };
 
-        std::vector<Ingredient> inputs;
-        std::vector<Ingredient> products;
+        // the most ingredients a recipe can have on either side
+        static constexpr std::size_t MAX_INGREDIENTS = 4;
+
+        // fixed capacity, so recipes can be constexpr and are copied without allocating
+        FixedVector<Ingredient, MAX_INGREDIENTS> inputs;
+        FixedVector<Ingredient, MAX_INGREDIENTS> products;
         int processing_time_s;
 
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(Recipe, inputs, products, processing_time_s)
     };
 
+    // entities are created while factories update in parallel, e.g. new storage stacks
     inline int generate_id() {
-        static int id = 0;
+        static std::atomic<int> id = 0;
         return id++;
     }
 
+    // Bit set of the scheduler slots that need an update, see Scheduler
+    struct AwakeSlots {
+        std::vector<std::uint64_t> bits;
+
+        void set(int const slot) {
+            if (slot >= 0 && slot < bits.size() * 64) {
+                bits[slot / 64] |= std::uint64_t{1} << slot % 64;
+            }
+        }
+    };
+
+    // The state of an entity that the scheduler currently does not update.
+    // Stacks wake their sleepers up as soon as they change.
+    struct SleepState {
+        std::weak_ptr<AwakeSlots> awake_slots;
+        int slot = -1;
+        bool sleeping = false;
+
+        void wake() {
+            if (!sleeping) {
+                return;
+            }
+            sleeping = false;
+            if (auto const slots = awake_slots.lock()) {
+                slots->set(slot);
+            }
+        }
+    };
+
     class GameWorldEntity {
     public:
+        GameWorldEntity() = default;
+
+        // a copy is a new entity, it never shares the sleep state of the original
+        GameWorldEntity(GameWorldEntity const &other): name(other.name) {
+        }
+
+        GameWorldEntity &operator=(GameWorldEntity const &other) {
+            name = other.name;
+            return *this;
+        }
+
         [[nodiscard]] virtual int getId() const = 0;
 
         virtual ~GameWorldEntity() = default;
 
         virtual void update(double dt) = 0;
 
+        // Scheduling hint, asked by the scheduler right after an update. 0 means the entity needs
+        // the next update. A positive time in ms (may be infinity) means that updates during that
+        // time would only add up the elapsed time, unless one of the watched stacks changes.
+        [[nodiscard]] virtual double getSleepTime() const { return 0; }
+
+        // registers the sleep state with every stack that ends the sleep when it changes
+        virtual void watchStacks(std::shared_ptr<SleepState> const &state) const {
+        }
+
+        [[nodiscard]] std::shared_ptr<SleepState> const &getSleepState() {
+            if (_sleep_state == nullptr) {
+                _sleep_state = std::make_shared<SleepState>();
+            }
+            return _sleep_state;
+        }
+
         std::string name = "GameWorldEntity";
+
+    private:
+        std::shared_ptr<SleepState> _sleep_state;
     };
 
+    static constexpr double SLEEP_FOREVER = std::numeric_limits<double>::infinity();
+
     class IInputLink {
     public:
         virtual ~IInputLink() = default;
 
         virtual void reconnectLinks(
             std::function<std::optional<std::shared_ptr<GameWorldEntity> >(int)> const &getEntityById) = 0;
+
+        // called when the links in the world changed, resolved input stacks are looked up again
+        virtual void invalidateLinks() {
+        }
+
+        // the counter of the factory the entity belongs to, every new link and every removed entity counts
+        // it up so the factory rebuilds its schedule and the inputs look up their stacks again. nullptr
+        // outside of a factory
+        virtual void setLinkGeneration(std::shared_ptr<std::atomic<unsigned> > const &) {
+        }
     };
 
     struct Stack final : GameWorldEntity {
+        friend void to_binary(BinaryWriter &w, const Stack &r);
+
+        friend void from_binary(BinaryReader &b, Stack &r);
+
         void clear() {
             _amount = 0;
             resource = std::nullopt;
+            wakeSleepers();
         }
 
         bool isEmpty() const {
@@ -103,7 +189,10 @@ namespace Fac {
             return resource.value();
         }
 
-        void lockResource(Resource const &r) { resource = r; }
+        void lockResource(Resource const &r) {
+            resource = r;
+            wakeSleepers();
+        }
 
         bool removeAmount(int const amount) {
             if (_amount >= amount) {
@@ -111,6 +200,7 @@ namespace Fac {
                 if (_amount == 0) {
                     clear();
                 }
+                wakeSleepers();
                 return true;
             }
             return false;
@@ -120,12 +210,33 @@ namespace Fac {
             return addAmount(1, r);
         }
 
+        // the number of items of the resource that still fit
+        [[nodiscard]] int getRoom(Resource const &r) const {
+            return resource == r || resource == std::nullopt ? _max_stack_size - _amount : 0;
+        }
+
+        // moves as many items as the target can take, but at most max_amount, in one step.
+        // Returns the number of items moved
+        int transferTo(Stack &target, int const max_amount = std::numeric_limits<int>::max()) {
+            if (&target == this || _amount == 0) {
+                return 0;
+            }
+            auto const amount = std::min({_amount, max_amount, target.getRoom(getResource())});
+            if (amount <= 0) {
+                return 0;
+            }
+            target.addAmount(amount, getResource());
+            removeAmount(amount);
+            return amount;
+        }
+
         bool addAmount(int const amount, Resource const &r) {
             if (_amount == 0) {
                 resource = r;
             }
             if (_amount + amount <= _max_stack_size && resource == r) {
                 _amount += amount;
+                wakeSleepers();
                 return true;
             }
             return false;
@@ -136,15 +247,42 @@ namespace Fac {
 
         int getId() const override { return _id; }
 
-        void setMaxStackSize(int max_stack_size) { _max_stack_size = max_stack_size; }
+        void setMaxStackSize(int max_stack_size) {
+            _max_stack_size = max_stack_size;
+            wakeSleepers();
+        }
+
+        // the sleeping entity is woken up with the next change of this stack
+        void addSleeper(std::shared_ptr<SleepState> const &state) {
+            std::erase_if(_sleepers, [](auto const &s) { return s.expired(); });
+            for (auto const &s: _sleepers) {
+                if (!s.owner_before(state) && !state.owner_before(s)) {
+                    return;
+                }
+            }
+            _sleepers.push_back(state);
+        }
 
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(Stack, _id, _amount, resource, _max_stack_size)
 
     private:
+        void wakeSleepers() {
+            if (_sleepers.empty()) {
+                return;
+            }
+            for (auto const &s: _sleepers) {
+                if (auto const state = s.lock()) {
+                    state->wake();
+                }
+            }
+            _sleepers.clear();
+        }
+
         int _amount = 0;
         int _id = generate_id();
         std::optional<Resource> resource = std::nullopt;
         int _max_stack_size = MAX_STACK_SIZE;
+        std::vector<std::weak_ptr<SleepState> > _sleepers;
     };
 
 
@@ -188,6 +326,11 @@ namespace Fac {
             return _output_stacks.at(slot);
         }
 
+        // like getOutputStack, without the reference counting, for the update loops
+        [[nodiscard]] Stack &outputStack(int const slot) const {
+            return *_output_stacks[slot];
+        }
+
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(OutputStackProvider, _output_stacks)
     };
 
@@ -202,6 +345,38 @@ namespace Fac {
             sourceId = 0;
             sourceOutputSlot = 0;
             cachedStack = nullptr;
+            emptyStack = nullptr;
+            invalidate();
+        }
+
+        // the stack this input reads from. It is looked up on the first access after the link changed or
+        // after the links of the factory changed (generation), later accesses neither lock the source nor
+        // call into it. The pointer does not own the stack: outside of a factory the source has to outlive it
+        [[nodiscard]] Stack &getStack(unsigned const generation) const {
+            if (resolvedStack == nullptr || resolvedGeneration != generation) {
+                resolvedStack = getSharedStack().get();
+                resolvedGeneration = generation;
+            }
+            return *resolvedStack;
+        }
+
+        // the same stack as getStack, locks the source for the ownership
+        [[nodiscard]] std::shared_ptr<Stack> getSharedStack() const {
+            if (auto const s = source.lock()) {
+                return s->getOutputStack(sourceOutputSlot);
+            }
+            if (cachedStack != nullptr) {
+                return cachedStack;
+            }
+            // the source is gone, the input sees an empty stack until it is connected again
+            if (emptyStack == nullptr) {
+                emptyStack = std::make_shared<Stack>();
+            }
+            return emptyStack;
+        }
+
+        void invalidate() const {
+            resolvedStack = nullptr;
         }
 
         void resetToCachedStack() {
@@ -212,6 +387,11 @@ namespace Fac {
         bool isBrokenLink() const {
             return source.lock() == nullptr && sourceId != 0;
         }
+
+    private:
+        mutable std::shared_ptr<Stack> emptyStack;
+        mutable Stack *resolvedStack = nullptr;
+        mutable unsigned resolvedGeneration = 0;
     };
 
 
@@ -229,18 +409,13 @@ namespace Fac {
 
         // if the connection has a link, it returns the linked OutputStack, otherwise it returns the cached stack
         [[nodiscard]] std::shared_ptr<Stack> getInputStack(int const slot) const override {
-            auto connection = _input_connections.at(slot);
-            if (auto const source = connection.source.lock()) {
-                return source->getOutputStack(connection.sourceOutputSlot);
-            }
+            return _input_connections.at(slot).getSharedStack();
+        }
 
-            // if the connection has no link, return the cached stack
-            // however, the link might be broken / gone, so we need create a cached stack
-            // on the fly if needed
-            if (connection.isBrokenLink()) {
-                connection.resetToCachedStack();
-            }
-            return connection.cachedStack;
+        // like getInputStack, without the reference counting, for the update loops
+        [[nodiscard]] Stack &inputStack(int const slot) const {
+            return _input_connections[slot].getStack(
+                _link_generation != nullptr ? _link_generation->load(std::memory_order_relaxed) : 0);
         }
 
         void connectInput(int const inputSlot,
@@ -255,26 +430,54 @@ namespace Fac {
             connection.sourceId = sourceEntity->getId();
             connection.sourceOutputSlot = sourceOutputSlot;
             connection.cachedStack = nullptr;
+            connection.invalidate();
+            if (_link_generation != nullptr) {
+                ++*_link_generation;
+            }
+        }
+
+        // the link of an input slot, sourceId is 0 if nothing is connected
+        [[nodiscard]] InputConnection const &getInputConnection(int const slot) const {
+            return _input_connections.at(slot);
         }
 
         void reconnectLinks(
             std::function<std::optional<std::shared_ptr<GameWorldEntity> >(int)> const &getEntityById) override {
             for (int inputSlot = 0; inputSlot < _input_connections.size(); inputSlot++) {
                 auto const &connection = _input_connections.at(inputSlot);
-                auto const node = getEntityById(connection.sourceId);
-                if (connection.cachedStack == nullptr && connection.sourceId != 0 && node.has_value()) {
+                if (connection.cachedStack != nullptr || connection.sourceId == 0) {
+                    continue;
+                }
+                if (auto const node = getEntityById(connection.sourceId); node.has_value()) {
                     connectInput(inputSlot, node.value(), connection.sourceOutputSlot);
-                    // std::cout << "Reconnected input " << inputSlot << " to " << connection.sourceId << std::endl;
                 }
             }
         }
 
+        void invalidateLinks() override {
+            for (auto const &connection: _input_connections) {
+                connection.invalidate();
+            }
+        }
+
+        void setLinkGeneration(std::shared_ptr<std::atomic<unsigned> > const &generation) override {
+            _link_generation = generation;
+            invalidateLinks();
+        }
+
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(InputStackProvider, _input_connections)
+
+    private:
+        std::shared_ptr<std::atomic<unsigned> > _link_generation;
     };
 
     // features an internal stack as a buffer
     // so it can link to a belt and provide a larger stack as outputConnection
     class BufferedConnection final : public InputStackProvider, public OutputStackProvider {
+        friend void to_binary(BinaryWriter &w, const BufferedConnection &r);
+
+        friend void from_binary(BinaryReader &b, BufferedConnection &r);
+
     public:
         explicit BufferedConnection(): InputStackProvider(1), OutputStackProvider(1) {
             _output_stacks[0]->setMaxStackSize(MAX_STACK_SIZE);
@@ -286,6 +489,8 @@ namespace Fac {
     class ResourceNode final : public GameWorldEntity {
         friend void from_json(const json &j, ResourceNode &r);;
 
+        friend void from_binary(BinaryReader &b, ResourceNode &r);
+
     public:
         ResourceNode() = default;
 
@@ -323,6 +528,10 @@ namespace Fac {
 
         friend void from_json(const json &j, Extractor &r);
 
+        friend void to_binary(BinaryWriter &w, const Extractor &r);
+
+        friend void from_binary(BinaryReader &b, Extractor &r);
+
     public:
         double extraction_progress = 0.0;
         bool extracting = false;
@@ -363,6 +572,10 @@ namespace Fac {
 
         void update(double dt) override;
 
+        [[nodiscard]] double getSleepTime() const override;
+
+        void watchStacks(std::shared_ptr<SleepState> const &state) const override;
+
         int getId() const override { return _id; }
 
         void reconnectLinks(
@@ -386,9 +599,12 @@ namespace Fac {
             return _extraction_speed;
         }
 
+        // number of items extracted since this extractor was created or loaded
+        long getExtractedAmount() const { return _extracted_amount; }
+
     private:
         void update_extraction_speed() {
-            _extraction_speed = _default_extraction_speed * resource_quality_multiplier.at(_res_node->getQuality());
+            _extraction_speed = _default_extraction_speed * resource_quality_multiplier[static_cast<std::size_t>(_res_node->getQuality())];
         }
 
         int _id = generate_id();
@@ -396,6 +612,8 @@ namespace Fac {
         std::shared_ptr<ResourceNode> _res_node = std::make_shared<ResourceNode>();
         int _extraction_speed = 60;
         int _default_extraction_speed = 60;
+        // runtime statistic, not part of a save
+        long _extracted_amount = 0;
     };
 
 
@@ -408,6 +626,10 @@ namespace Fac {
 
         friend void to_json(json &j, const Machine &r);
 
+        friend void to_binary(BinaryWriter &w, const Machine &r);
+
+        friend void from_binary(BinaryReader &b, Machine &r);
+
     public:
         double processing_progress = 0.0;
         bool processing = false;
@@ -423,14 +645,18 @@ namespace Fac {
 
         void setRecipe(std::optional<Recipe> const &r);
 
-        [[nodiscard]] std::optional<Recipe> getRecipe() const;
+        [[nodiscard]] std::optional<Recipe> const &getRecipe() const { return _active_recipe; }
 
-        int getInputRpm() const;
+        int getInputRpm() const { return _input_rpm; }
 
-        int getOutputRpm() const;
+        int getOutputRpm() const { return _output_rpm; }
 
         void update(double dt) override;
 
+        [[nodiscard]] double getSleepTime() const override;
+
+        void watchStacks(std::shared_ptr<SleepState> const &state) const override;
+
         int getId() const override { return _id; }
 
         bool canStartProduction() const;
@@ -440,6 +666,11 @@ namespace Fac {
             return _input_connections.at(slot).getOutputStack(0);
         }
 
+        // the buffer of an input slot, without the reference counting of getInputStack
+        [[nodiscard]] Stack &inputStack(int const slot) const {
+            return _input_connections[slot].outputStack(0);
+        }
+
         void connectInput(int const inputSlot,
                           std::shared_ptr<GameWorldEntity> sourceEntity,
                           int sourceOutputSlot) override {
@@ -447,6 +678,10 @@ namespace Fac {
             connection.connectInput(0, sourceEntity, sourceOutputSlot);
         }
 
+        [[nodiscard]] InputConnection const &getInputConnection(int const slot) const {
+            return _input_connections.at(slot).getInputConnection(0);
+        }
+
         void reconnectLinks(
             std::function<std::optional<std::shared_ptr<GameWorldEntity> >(int)> const &getEntityById) override {
             for (auto &connection: _input_connections) {
@@ -454,12 +689,36 @@ namespace Fac {
             }
         }
 
+        void invalidateLinks() override {
+            for (auto &connection: _input_connections) {
+                connection.invalidateLinks();
+            }
+        }
+
+        void setLinkGeneration(std::shared_ptr<std::atomic<unsigned> > const &generation) override {
+            for (auto &connection: _input_connections) {
+                connection.setLinkGeneration(generation);
+            }
+        }
+
         int getInputSlots() const { return _input_slots; }
         int getOutputSlots() const { return _output_slots; }
 
+        // items put into the output stacks since this machine was created or loaded, per resource
+        ResourceArray<long> const &getProducedAmounts() const { return _produced_amounts; }
+
     private:
         int _id = generate_id();
+        // recalculates the values derived from the active recipe
+        void prepareRecipe();
+
         std::optional<Recipe> _active_recipe;
+        // derived from the active recipe when it is set, the updates only read them
+        double _processing_time_ms = 0;
+        int _input_rpm = 0;
+        int _output_rpm = 0;
+        // runtime statistic, not part of a save
+        ResourceArray<long> _produced_amounts;
         int _input_slots = 0;
         int _output_slots = 0;
         std::vector<BufferedConnection> _input_connections;
@@ -474,14 +733,14 @@ namespace Fac {
     class ItemMover : public InputStackProvider, public OutputStackProvider,
                       public std::enable_shared_from_this<ItemMover> {
     public:
-        int getItemsPerSecond() const { return _items_per_s; }
-        void setItemsPerSecond(int const items_per_s) { _items_per_s = items_per_s; }
+        double getItemsPerSecond() const { return _items_per_s; }
+        void setItemsPerSecond(double const items_per_s) { _items_per_s = items_per_s; }
 
         bool getActive() const { return _active; }
         bool getJammed() const { return _jammed; }
 
         ItemMover(int const input_nodes, int const output_nodes,
-                  int const items_per_s): InputStackProvider(input_nodes), OutputStackProvider(output_nodes),
+                  double const items_per_s): InputStackProvider(input_nodes), OutputStackProvider(output_nodes),
                                           _items_per_s(items_per_s) {
             // All item movers have a max stack size of 1
             std::ranges::for_each(_output_stacks, [&](std::shared_ptr<Stack> &output_stack) {
@@ -496,26 +755,93 @@ namespace Fac {
         }
 
     protected:
+        // while an item is in transit nothing happens until the transfer time is reached
+        [[nodiscard]] double getTransferSleepTime() const {
+            if (_active && !_in_transit_stack.empty()) {
+                return std::max(0.0, 1000 / _items_per_s - _time_to_next_transfer);
+            }
+            return 0;
+        }
+
         double _time_to_next_transfer = 0.0;
-        int _items_per_s = 0;
+        double _items_per_s = 0;
         bool _active = false;
         bool _jammed = false;
     };
 
 
+    /**
+     * Belt
+     * ----
+     * A lane with room for getLength() items. Items enter at the input end at most once per
+     * 1 / items per second, every item needs getLength() of these intervals to reach the output.
+     * The lane is a ring buffer of the items and the times they entered, the position of an item
+     * follows from its entry time. Moving the items along does not touch them, an update only deals
+     * with the item leaving at the front and the one entering at the back.
+     *
+     * A belt with a length of 1 moves a single item at a time.
+     */
     class Belt final : public GameWorldEntity, public ItemMover {
+        friend void to_json(json &j, const Belt &r);
+
         friend void from_json(const json &j, Belt &r);
 
+        friend void to_binary(BinaryWriter &w, const Belt &r);
+
+        friend void from_binary(BinaryReader &b, Belt &r);
+
     public:
-        explicit Belt(int const items_per_s = 1): ItemMover(1, 1, items_per_s) {
+        explicit Belt(double const items_per_s = 1, int const length = 1): ItemMover(1, 1, items_per_s) {
+            setLength(length);
         }
 
+        // the number of items the belt carries at the same time, items that do not fit are dropped
+        void setLength(int length);
+
+        [[nodiscard]] int getLength() const { return static_cast<int>(_lane.size()); }
+
+        [[nodiscard]] int getItemCount() const { return _lane_count; }
+
+        // the items on the belt, the first one leaves next
+        [[nodiscard]] std::vector<Resource> getItems() const;
+
         void update(double dt) override;
 
+        [[nodiscard]] double getSleepTime() const override;
+
+        void watchStacks(std::shared_ptr<SleepState> const &state) const override;
+
         int getId() const override { return _id; }
 
     protected:
         int _id = generate_id();
+
+    private:
+        struct LaneItem {
+            Resource resource = Resource::None;
+            // belt time at which the item entered
+            double entered = 0;
+        };
+
+        [[nodiscard]] double getSpacing() const { return 1000 / _items_per_s; }
+
+        // the time at which the front item reaches the output, items keep their spacing when they leave
+        [[nodiscard]] double getFrontExitTime() const {
+            return std::max(_lane[_lane_head].entered + getSpacing() * getLength(), _next_exit);
+        }
+
+        void push(Resource resource);
+
+        void pop();
+
+        std::vector<LaneItem> _lane = std::vector<LaneItem>(1);
+        int _lane_head = 0;
+        int _lane_count = 0;
+        // time of the belt, advanced by every update
+        double _clock = 0;
+        // earliest times for the next item to enter and to leave
+        double _next_entry = 0;
+        double _next_exit = 0;
     };
 
 
@@ -525,12 +851,20 @@ namespace Fac {
     class Splitter final : public GameWorldEntity, public ItemMover {
         friend void from_json(const json &j, Splitter &r);
 
+        friend void to_binary(BinaryWriter &w, const Splitter &r);
+
+        friend void from_binary(BinaryReader &b, Splitter &r);
+
     public:
         Splitter(): ItemMover(1, 2, 1) {
         }
 
         void update(double dt) override;
 
+        [[nodiscard]] double getSleepTime() const override;
+
+        void watchStacks(std::shared_ptr<SleepState> const &state) const override;
+
         int getId() const override { return _id; }
 
     private:
@@ -542,12 +876,20 @@ namespace Fac {
     class Merger final : public GameWorldEntity, public ItemMover {
         friend void from_json(const json &j, Merger &r);
 
+        friend void to_binary(BinaryWriter &w, const Merger &r);
+
+        friend void from_binary(BinaryReader &b, Merger &r);
+
     public:
         Merger(): ItemMover(2, 1, 1) {
         }
 
         void update(double dt) override;
 
+        [[nodiscard]] double getSleepTime() const override;
+
+        void watchStacks(std::shared_ptr<SleepState> const &state) const override;
+
         int getId() const override { return _id; }
 
     private:
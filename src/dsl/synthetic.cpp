@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <array>
+#include <span>
+#include "dsl.h"
+#include "synthetic.h"
+
+using namespace DSL;
+using namespace Fac;
+
+namespace {
+    constexpr std::array EXTRACTOR_SPEEDS = {60, 120, 240};
+
+    // the first recipe of the table that makes the resource
+    std::optional<Recipe> recipeFor(Resource const resource) {
+        auto const recipe = std::ranges::find_if(RECIPES, [resource](Recipe const &r) {
+            return !r.products.empty() && r.products.front().resource == resource;
+        });
+        return recipe != RECIPES.end() ? std::make_optional(*recipe) : std::nullopt;
+    }
+
+    class LineBuilder {
+    public:
+        LineBuilder(std::shared_ptr<Factory> const &factory, SyntheticFactoryOptions const &options)
+            : _fac(factory), _options(options) {
+        }
+
+        void line(Recipe const &recipe) {
+            auto const product = produce(recipe, _options.chain_depth);
+            for (auto const &output: split(product, _options.storages)) {
+                auto const storage = add(Storage());
+                storage->setMaxItemStacks(12);
+                link(output, Connection{storage, 0});
+            }
+        }
+
+        [[nodiscard]] long getEntities() const { return _entities; }
+
+    private:
+        template<typename T>
+        std::shared_ptr<T> add(T const &entity) {
+            _entities++;
+            return create(_fac, entity);
+        }
+
+        void link(Connection const &from_output, Connection const &to_input) {
+            auto const &tiers = _options.belt_rpm;
+            auto const rpm = tiers.empty() ? 60 : tiers[_belts++ % tiers.size()];
+            linkWithBelt(add(Belt(1, _options.belt_length)), from_output, to_input, rpm);
+        }
+
+        // an output delivering the resource, made by machines while the depth allows it
+        Connection source(Resource const resource, int const depth) {
+            if (depth > 0) {
+                if (auto const recipe = recipeFor(resource); recipe.has_value()) {
+                    return produce(*recipe, depth);
+                }
+            }
+            auto const node = add(ResourceNode());
+            node->setResource(resource);
+            auto const extractor = add(Extractor());
+            extractor->setResourceNode(node);
+            extractor->setDefaultSpeed(EXTRACTOR_SPEEDS[_extractors++ % EXTRACTOR_SPEEDS.size()]);
+            return Connection{extractor, 0};
+        }
+
+        // width machines making the recipe, returns the output collecting their products
+        Connection produce(Recipe const &recipe, int const depth) {
+            auto const width = std::max(1, _options.width);
+            // the connection of every machine, per input slot
+            std::vector<std::vector<Connection> > inputs;
+            for (auto const &input: recipe.inputs) {
+                inputs.push_back(split(source(input.resource, depth - 1), width));
+            }
+
+            std::vector<Connection> products;
+            for (int i = 0; i < width; i++) {
+                auto const machine = add(Machine(std::max<int>(1, recipe.inputs.size()),
+                                                 std::max<int>(1, recipe.products.size())));
+                machine->setRecipe(recipe);
+                for (int slot = 0; slot < inputs.size(); slot++) {
+                    link(inputs[slot][i], Connection{machine, slot});
+                }
+                products.emplace_back(machine, 0);
+            }
+            return merge(products);
+        }
+
+        // a tree of splitters dividing the output into n outputs
+        std::vector<Connection> split(Connection const &output, int const n) {
+            if (n <= 1) {
+                return {output};
+            }
+            auto const splitter = add(Splitter());
+            splitter->setItemsPerSecond(1000);
+            link(output, Connection{splitter, 0});
+
+            auto result = split(Connection{splitter, 0}, (n + 1) / 2);
+            for (auto const &right: split(Connection{splitter, 1}, n / 2)) {
+                result.push_back(right);
+            }
+            return result;
+        }
+
+        // a tree of mergers collecting the outputs into one
+        Connection merge(std::span<Connection const> const outputs) {
+            if (outputs.size() == 1) {
+                return outputs.front();
+            }
+            auto const half = (outputs.size() + 1) / 2;
+            auto const left = merge(outputs.first(half));
+            auto const right = merge(outputs.subspan(half));
+
+            auto const merger = add(Merger());
+            merger->setItemsPerSecond(1000);
+            link(left, Connection{merger, 0});
+            link(right, Connection{merger, 1});
+            return Connection{merger, 0};
+        }
+
+        std::shared_ptr<Factory> _fac;
+        SyntheticFactoryOptions const &_options;
+        long _entities = 0;
+        size_t _belts = 0;
+        size_t _extractors = 0;
+    };
+}
+
+void SyntheticFactory::build(std::shared_ptr<Factory> const &factory, SyntheticFactoryOptions const &options) {
+    auto builder = LineBuilder(factory, options);
+    for (size_t line = 0; builder.getEntities() < options.entities; line++) {
+        builder.line(RECIPES[(static_cast<size_t>(options.first_recipe) + line) % RECIPE_COUNT]);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <vector>
+#include "../factory.h"
+
+/**
+ * Synthetic factories
+ * -------------------
+ * Builds factories of any size from the recipe table, for load tests and benchmarks.
+ *
+ * A factory is made of independent production lines. Each line produces one recipe of the table,
+ * the inputs of a recipe are produced by further machines up to the chain depth, deeper inputs
+ * and raw resources come from extractors. Every step runs on several machines in parallel, fed by
+ * splitter trees and collected by merger trees. The product ends in storages.
+ *
+ * The same options always build the same factory.
+ */
+struct SyntheticFactoryOptions {
+    // lines are added until the factory has at least this many entities
+    long entities = 1000;
+    // the number of machines in a row that make the inputs of the next one
+    int chain_depth = 2;
+    // the number of machines working on each step of a chain
+    int width = 2;
+    // the number of storages at the end of each line
+    int storages = 1;
+    // the belts of a line cycle through these speeds, in items per minute
+    std::vector<int> belt_rpm = {60, 120, 270, 480};
+    // the length of every belt
+    int belt_length = 2;
+    // the first line makes this recipe, the next lines the following ones of the table
+    Fac::RecipeId first_recipe = Fac::RecipeId::IronIngot;
+};
+
+struct SyntheticFactory {
+    static void build(std::shared_ptr<Fac::Factory> const &factory, SyntheticFactoryOptions const &options);
+};
+
+#endif //SYNTHETIC_H
@@ -0,0 +1,171 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game.h"
+#include "save.h"
+
+/**
+ * Autosave
+ * --------
+ * Saves the game periodically without holding up the simulation. The thread that owns the game
+ * state only encodes it into the binary format, which is a flat copy of the state at that moment.
+ * Writing the file happens on a background thread; a JSON save file is decoded from that copy
+ * there and written as JSON.
+ *
+ * A binary save file is written in full only from time to time, the saves in between append the
+ * changes to its journal (see Journal).
+ *
+ * Files are written next to the save file and renamed, a crash during a save keeps the last one.
+ */
+class Autosave {
+public:
+    static constexpr auto DEFAULT_INTERVAL = std::chrono::seconds(60);
+
+    explicit Autosave(std::string file, std::chrono::steady_clock::duration const interval = DEFAULT_INTERVAL)
+        : _file(std::move(file)), _interval(interval), _next_save(std::chrono::steady_clock::now() + interval) {
+        _thread = std::jthread([this](std::stop_token const &stop_token) { run(stop_token); });
+    }
+
+    Autosave(Autosave const &) = delete;
+
+    Autosave &operator=(Autosave const &) = delete;
+
+    ~Autosave() { stop(); }
+
+    // called by the owner of the state, e.g. after every tick. Takes a snapshot once the interval has passed
+    void update(GameState &state) {
+        if (std::chrono::steady_clock::now() >= _next_save) {
+            save(state);
+        }
+    }
+
+    // takes a snapshot now. A full snapshot replaces the ones that have not been written yet,
+    // journal entries are written in order
+    void save(GameState &state) {
+        if (_write_failed.exchange(false)) {
+            _journal.clear();
+        }
+        auto pending = PendingWrite();
+        if (isJsonSaveFile(_file)) {
+            pending = {true, encodeGameState(state)};
+        } else if (_journal.needsCompaction()) {
+            pending = {true, encodeGameState(state, &_journal)};
+        } else {
+            pending = {false, _journal.delta(state)};
+        }
+        {
+            std::lock_guard lock(_mutex);
+            if (pending.full) {
+                _pending.clear();
+            }
+            _pending.push_back(std::move(pending));
+        }
+        _wake.notify_one();
+        _next_save = std::chrono::steady_clock::now() + _interval;
+    }
+
+    // waits until the latest snapshot is written
+    void flush() {
+        std::unique_lock lock(_mutex);
+        _idle.wait(lock, [this] { return _pending.empty() && !_writing; });
+    }
+
+    // writes the latest snapshot and stops the background thread
+    void stop() {
+        if (_thread.joinable()) {
+            flush();
+            _thread.request_stop();
+            _thread.join();
+        }
+    }
+
+    [[nodiscard]] int getSavesWritten() const {
+        std::lock_guard lock(_mutex);
+        return _saves_written;
+    }
+
+private:
+    struct PendingWrite {
+        // a full save, otherwise a journal entry
+        bool full = true;
+        std::vector<char> data;
+    };
+
+    void run(std::stop_token const &stop_token) {
+        while (true) {
+            std::vector<PendingWrite> writes;
+            {
+                std::unique_lock lock(_mutex);
+                if (!_wake.wait(lock, stop_token, [this] { return !_pending.empty(); })) {
+                    return;
+                }
+                writes.swap(_pending);
+                _writing = true;
+            }
+            for (auto const &w: writes) {
+                // the entries after a failed write do not fit the file, they are skipped until a full save
+                if (!w.full && _skipping_entries) {
+                    continue;
+                }
+                _skipping_entries = !write(w);
+                if (_skipping_entries) {
+                    _write_failed = true;
+                }
+            }
+            {
+                std::lock_guard lock(_mutex);
+                _writing = false;
+            }
+            _idle.notify_all();
+        }
+    }
+
+    bool write(PendingWrite const &w) {
+        try {
+            if (isJsonSaveFile(_file)) {
+                auto state = decodeGameState(w.data);
+                saveGameState(state, _file);
+            } else if (w.full) {
+                writeBinarySave(_file, w.data);
+            } else {
+                appendToJournal(_file, w.data);
+            }
+            std::lock_guard lock(_mutex);
+            _saves_written++;
+            return true;
+        } catch (std::exception const &e) {
+            std::cerr << "Autosave failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    std::string _file;
+    std::chrono::steady_clock::duration _interval;
+    // only used by the owner of the state
+    std::chrono::steady_clock::time_point _next_save;
+    // only used by the owner of the state, what the file holds once the pending writes are done
+    Journal _journal;
+    std::atomic<bool> _write_failed = false;
+    mutable std::mutex _mutex;
+    std::condition_variable_any _wake;
+    std::condition_variable _idle;
+    std::vector<PendingWrite> _pending;
+    // only used by the background thread
+    bool _skipping_entries = false;
+    bool _writing = false;
+    int _saves_written = 0;
+    // declared last, so the thread is stopped before the members it uses are destroyed
+    std::jthread _thread;
+};
+
+#endif //AUTOSAVE_H
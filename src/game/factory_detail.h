@@ -3,6 +3,8 @@
 #include <__format/format_functions.h>
 
 #include "imgui.h"
+#include "simulation.h"
+#include "snapshot.h"
 #include "../sim.h"
 #include "../tools/format.h"
 
@@ -11,44 +13,60 @@ using namespace Fac;
 using namespace Gui;
 
 struct FactoryDetailWindowViewModel {
-    std::shared_ptr<Factory> factory;
+    Simulation &simulation;
+    int factory_id;
 
-    void sellExtractor(const std::shared_ptr<Extractor> &extractor) const {
-        deferCall([=]() {
-            factory->removeEntity(extractor);
+    // the latest state of the factory, nullptr once it was sold
+    [[nodiscard]] std::shared_ptr<FactorySnapshot const> getFactory() const {
+        auto const game = simulation.getSnapshot();
+        auto const factory = game->getFactoryById(factory_id);
+        return factory != nullptr ? std::shared_ptr<FactorySnapshot const>(game, factory) : nullptr;
+    }
+
+    // runs the change on the simulation thread, if the factory still exists
+    void modify(std::function<void(Factory &)> const &change) const {
+        simulation.post([id = factory_id, change](GameState &state) {
+            if (auto const factory = state.getFactoryById(id)) {
+                change(*factory);
+            }
         });
     }
 
-    void connectExtractorToResourceNode(const std::shared_ptr<Extractor> &extractor,
-                                        int const resourceNodeId) const {
-        deferCall([=] {
-            extractor->setResourceNode(
-                std::dynamic_pointer_cast<ResourceNode>(factory->getEntityById(resourceNodeId).value()));
+    void sellExtractor(int const extractor_id) const {
+        modify([=](Factory &factory) {
+            if (auto const e = factory.getEntityById(extractor_id); e.has_value()) {
+                factory.removeEntity(e.value());
+            }
         });
     }
 
-    auto getUnconnectedExtractors() const {
-        const auto ent = factory->getEntitiesByType<Extractor>();
-        std::vector<std::shared_ptr<Extractor> > result;
-        for (const auto &e: ent) {
-            if (!e->hasResourceNode()) {
-                result.push_back(e);
+    void connectExtractorToResourceNode(int const extractor_id, int const resourceNodeId) const {
+        modify([=](Factory &factory) {
+            auto const extractor = factory.getEntityById(extractor_id);
+            auto const node = factory.getEntityById(resourceNodeId);
+            if (extractor.has_value() && node.has_value()) {
+                std::dynamic_pointer_cast<Extractor>(extractor.value())->setResourceNode(
+                    std::dynamic_pointer_cast<ResourceNode>(node.value()));
             }
-        }
-        return result;
+        });
     }
 
-    std::shared_ptr<Extractor> resourceNodeHasExtractor(const std::shared_ptr<ResourceNode> &node) const {
-        for (const auto &e: factory->getEntitiesByType<Extractor>()) {
-            if (e->getResourceNode()->getId() == node->getId()) {
-                return e;
+    static auto getUnconnectedExtractors(FactorySnapshot const &factory) {
+        std::vector<ExtractorSnapshot> result;
+        for (const auto &e: factory.extractors) {
+            if (!e.has_resource_node) {
+                result.push_back(e);
             }
         }
-        return nullptr;
+        return result;
     }
 
-    void disconnectExtractorFromResourceNode(const std::shared_ptr<Extractor> & extractor) const {
-        extractor->clearResourceNode();
+    void disconnectExtractorFromResourceNode(int const extractor_id) const {
+        modify([=](Factory &factory) {
+            if (auto const e = factory.getEntityById(extractor_id); e.has_value()) {
+                std::dynamic_pointer_cast<Extractor>(e.value())->clearResourceNode();
+            }
+        });
     }
 };
 
@@ -57,64 +75,63 @@ public:
     explicit FactoryDetailWindow(FactoryDetailWindowViewModel model): view_model(std::move(model)) {
     }
 
-    void showFactoryList() const {
+    static void showFactoryList(FactorySnapshot const &factory) {
         if (BeginTable("table1", 7)) {
-            for (auto &entity: view_model.factory->getEntities()) {
+            for (auto const &m: factory.machines) {
                 TableNextRow();
-                if (const auto m = std::dynamic_pointer_cast<Machine>(entity); m) {
-                    TableNextColumn();
-                    Checkbox(std::format("##{0}", m->getId()).c_str(), &m->processing);
-                    TableNextColumn();
-                    ProgressBar(m->processing_progress / (m->getRecipe().value().processing_time_s * 1000));
-                    TableNextColumn();
-                    auto resourceName = camelCaseToSpaced(
-                        resourceToString(m->getRecipe().value().products.front().resource).data());
-                    Text(resourceName.c_str());
+                TableNextColumn();
+                auto processing = m.processing;
+                BeginDisabled();
+                Checkbox(std::format("##{0}", m.id).c_str(), &processing);
+                EndDisabled();
+                TableNextColumn();
+                ProgressBar(m.progress);
+                TableNextColumn();
+                auto resourceName = m.product.has_value()
+                                        ? camelCaseToSpaced(resourceToString(m.product.value()).data())
+                                        : std::string();
+                Text(resourceName.c_str());
+                TableNextColumn();
+                Text(std::format("Mach: {0}", m.id).c_str());
+                for (int i = 0; i < m.input_amounts.size(); i++) {
                     TableNextColumn();
-                    Text(std::format("Mach: {0} {1}", m->getId(), m->name).c_str());
-                    for (int i = 0; i < m->getInputSlots(); i++) {
-                        TableNextColumn();
-                        Text(std::format("I{0}: {1}", i, m->getInputStack(i)->getAmount()).c_str());
-                    }
-                    for (int i = 0; i < m->getOutputSlots(); i++) {
-                        TableNextColumn();
-                        Text(std::format("O{0}: {1}", i, m->getOutputStack(i)->getAmount()).c_str());
-                    }
+                    Text(std::format("I{0}: {1}", i, m.input_amounts[i]).c_str());
+                }
+                for (int i = 0; i < m.output_amounts.size(); i++) {
                     TableNextColumn();
-                    // Text(std::format("P: {0}", m->processing).c_str());
-                    Text(std::format("PPM: {0}", m->getInputRpm()).c_str());
-
-                    // Text(std::format("T: {0}", m->getRecipe().value().processing_time_s * 1000 - m->processing_progress).c_str());
+                    Text(std::format("O{0}: {1}", i, m.output_amounts[i]).c_str());
                 }
+                TableNextColumn();
+                Text(std::format("PPM: {0}", m.input_rpm).c_str());
             }
             EndTable();
         }
     }
 
-    void listResourceNodes() const {
+    void listResourceNodes(FactorySnapshot const &factory) const {
         if (!BeginTable("table_resource_nodes", 7)) return;
 
-        for (const auto &m: view_model.factory->getEntitiesByType<ResourceNode>()) {
-            auto id = m->getId();
+        for (const auto &m: factory.resource_nodes) {
+            auto id = m.id;
 
-            connectionPopup(id);
+            connectionPopup(factory, id);
             TableNextRow();
             TableNextColumn();
-            auto resourceName = camelCaseToSpaced(resourceToString(m->getResource()).data());
+            auto resourceName = camelCaseToSpaced(resourceToString(m.resource).data());
             Text(resourceName.c_str());
             TableNextColumn();
-            auto quality = resourceQualityToString(m->getQuality());
+            auto quality = resourceQualityToString(m.quality);
             Text(quality.data());
             TableNextColumn();
-            if (view_model.resourceNodeHasExtractor(m) != nullptr) {
+            if (m.extractor_id != -1) {
                 Text("Connected");
             } else {
                 Text("Unconnected");
             }
             TableNextColumn();
-            if (auto e = view_model.resourceNodeHasExtractor(m); e != nullptr) {
+            if (m.extractor_id != -1) {
                 if (Button(STR("Disconnect##{0}", id))) {
-                    view_model.disconnectExtractorFromResourceNode(e);
+                    view_model.disconnectExtractorFromResourceNode(m.extractor_id);
                 }
             } else {
                 if (Button(STR("Connect##{0}", id))) {
@@ -126,15 +143,15 @@ public:
         EndTable();
     }
 
-    void connectionPopup(const int id) const {
+    void connectionPopup(FactorySnapshot const &factory, const int id) const {
         if (!BeginPopupModal(STR("Connect#{0}", id), nullptr, ImGuiWindowFlags_AlwaysAutoResize)) return;
 
         Text("Connect to Resource Node");
         Separator();
-        for (const auto &extractor: view_model.getUnconnectedExtractors()) {
+        for (const auto &extractor: FactoryDetailWindowViewModel::getUnconnectedExtractors(factory)) {
 
-            if (Selectable(STR("Extractor {0}", extractor->getId()))) {
-                view_model.connectExtractorToResourceNode(extractor, id);
+            if (Selectable(STR("Extractor {0}", extractor.id))) {
+                view_model.connectExtractorToResourceNode(extractor.id, id);
             }
         }
         if (Button("OK", ImVec2(120, 0))) {
@@ -147,34 +164,33 @@ public:
         EndPopup();
     }
 
-    void listExtractors() const {
+    void listExtractors(FactorySnapshot const &factory) const {
         if (!BeginTable("table_extractors", 7))
             return;
 
-        for (auto &m: view_model.factory->getEntitiesByType<Extractor>()) {
-            auto id = m->getId();
+        for (auto const &m: factory.extractors) {
+            auto id = m.id;
             TableNextRow();
 
             TableNextColumn();
             Text(STR("#{0}", id));
             TableNextColumn();
+            auto extracting = m.extracting;
             BeginDisabled();
-            Checkbox(STR("Active##{0}", id), &m->extracting);
+            Checkbox(STR("Active##{0}", id), &extracting);
             EndDisabled();
             TableNextColumn();
-            ProgressBar(m->extraction_progress / 100);
+            ProgressBar(m.extraction_progress / 100);
             TableNextColumn();
-            auto resource_node = camelCaseToSpaced(
-                resourceToString(m->getResourceNode()->getResource()).data());
+            auto resource_node = camelCaseToSpaced(resourceToString(m.resource).data());
             Text(resource_node.c_str());
             TableNextColumn();
-            Text(STR("{0}", m->getOutputRpm()));
+            Text(STR("{0}", m.output_rpm));
             TableNextColumn();
-            auto output_amount = m->getOutputStack(0)->getAmount();
-            Text(STR("{0}", output_amount));
+            Text(STR("{0}", m.output_amount));
             TableNextColumn();
             if (Button(STR("Sell##{0}", id))) {
-                view_model.sellExtractor(m);
+                view_model.sellExtractor(id);
             }
         }
         EndTable();
@@ -182,7 +198,11 @@ public:
 
 
     void render(const std::shared_ptr<bool> &is_open) const override {
-        auto id = view_model.factory->getId();
+        auto const factory = view_model.getFactory();
+        if (factory == nullptr) {
+            return;
+        }
+        auto id = factory->id;
         int selected_fish = -1;
         const char *names[] = {"IronOre", "CopperOre", "Coal", "Stone", "CrudeOil", "Water", "Uranium"};
 
@@ -194,12 +214,12 @@ public:
 
         if (BeginTabBar("##tabs")) {
             if (BeginTabItem("Resources")) {
-                listResourceNodes();
+                listResourceNodes(*factory);
                 EndTabItem();
             }
 
             if (BeginTabItem("Extractors")) {
-                listExtractors();
+                listExtractors(*factory);
                 EndTabItem();
                 Separator();
                 if (Button("Select.."))
@@ -216,7 +236,7 @@ public:
             }
 
             // if (BeginTabItem("All")) {
-            //     showFactoryList();
+            //     showFactoryList(*factory);
             //     EndTabItem();
             // }
 
@@ -4,33 +4,40 @@
 #include "game.h"
 #include "imgui.h"
 #include "navigation.h"
+#include "simulation.h"
 #include "../sim.h"
 #include "../tools/format.h"
 #include "../tools/gui.h"
 
 struct FactoryOverviewWindowViewModel {
-    explicit FactoryOverviewWindowViewModel(GameState &state, Navigation &navigation): navigation(navigation),
-        state(state) {
+    explicit FactoryOverviewWindowViewModel(Simulation &simulation, Navigation &navigation): navigation(navigation),
+        simulation(simulation) {
     }
 
     void buyFactory() const {
-        state.credits -= 1000;
-        state.addFactory(std::make_shared<Fac::Factory>());
+        simulation.post([](GameState &state) {
+            state.credits -= 1000;
+            state.addFactory(std::make_shared<Fac::Factory>());
+        });
     }
 
     void sellFactory(int const id) const {
-        deferCall([&]() {
+        simulation.post([id](GameState &state) {
             state.credits += 1000;
             state.removeFactoryById(id);
         });
     }
 
+    // a stored factory is loaded, so the window can show its entities
     void openFactoryDetailWindow(int const id) const {
+        simulation.post([id](GameState &state) {
+            state.loadFactory(id);
+        });
         navigation.openWindow(FACTORY_DETAIL, id);
     }
 
     Navigation &navigation;
-    GameState &state;
+    Simulation &simulation;
 };
 
 
@@ -59,20 +66,21 @@ public:
             ImGui::End();
             return;
         }
-        ImGui::Text("Credits: %f", _viewModel.state.credits);
+        auto const snapshot = _viewModel.simulation.getSnapshot();
+        ImGui::Text("Credits: %f", snapshot->credits);
         ImGui::Separator();
         if (ImGui::Button("Buy new Factory (-1000)")) {
             _viewModel.buyFactory();
         }
         ImGui::Separator();
         ImGui::Text("Factories:");
-        if (_viewModel.state.getFactories().empty()) {
+        if (snapshot->factories.empty()) {
             ImGui::Text("No factories");
         } else {
             if (ImGui::BeginTable("factories_table", 3)) {
-                for (const auto &factory: _viewModel.state.getFactories()) {
+                for (const auto &factory: snapshot->factories) {
                     ImGui::TableNextRow();
-                    auto const id = factory->getId();
+                    auto const id = factory.id;
                     confirmationPopup(id);
                     ImGui::TableNextColumn();
                     ImGui::Text("Factory: %d", id);
@@ -92,9 +100,11 @@ public:
         }
         ImGui::Separator();
         ImGui::Text("Global Resources:");
-        for (const auto &[resource, amount]: _viewModel.state.resources) {
-            ImGui::Text("%s: %d", Fac::resourceToString(resource).data(), amount);
-        }
+        snapshot->resources.forEach([](Fac::Resource const resource, int const amount) {
+            if (amount != 0) {
+                ImGui::Text("%s: %d", Fac::resourceToString(resource).data(), amount);
+            }
+        });
         ImGui::Separator();
 
         ImGui::End();
@@ -1,8 +1,12 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <ostream>
+#include <utility>
+
 #include "../sim.h"
 #include "navigation.h"
+#include "stored_factory.h"
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::json;
@@ -14,6 +18,11 @@ struct GameState {
         for (const auto &factory: r.factories) {
             factories.push_back(*factory);
         }
+        // JSON has no stored form, stored factories are loaded for the export so the time they were
+        // stored is not lost
+        for (const auto &factory: r.stored_factories) {
+            factories.push_back(*factory.load());
+        }
 
         j = json{
             {
@@ -26,45 +35,125 @@ struct GameState {
         };
     }
 
+    // writes the same JSON as to_json to the stream, without a document of the whole state. Only
+    // one factory is loaded for a stored factory at a time
+    friend void writeJson(std::ostream &out, const GameState &r) {
+        // the keys in the order of to_json, which sorts them
+        out << R"({"gameState":{"credits":)" << json(r.credits) << R"(,"factories":[)";
+        auto first = true;
+        for (const auto &factory: r.factories) {
+            out << (first ? "" : ",");
+            Fac::writeJson(out, *factory);
+            first = false;
+        }
+        for (const auto &factory: r.stored_factories) {
+            out << (first ? "" : ",");
+            Fac::writeJson(out, *factory.load());
+            first = false;
+        }
+        out << R"(],"resources":)" << json(r.resources) << "}}";
+    }
+
     friend void from_json(const json &j, GameState &r) {
+        auto pool = ThreadPool();
+        r = fromJson(j, pool);
+    }
+
+    // Loads a state like from_json. The factories are independent of each other, so each one is
+    // built and linked as its own job on the pool.
+    static GameState fromJson(const json &j, ThreadPool &pool) {
+        auto r = GameState();
         r.credits = j.at("gameState").at("credits").get<float>();
-        r.resources = j.at("gameState").at("resources").get<std::map<Fac::Resource, int> >();
-        for (const auto &factory: j.at("gameState").at("factories")) {
-            r.factories.push_back(std::make_shared<Fac::Factory>(factory.get<Fac::Factory>()));
-        }
+        r.resources = j.at("gameState").at("resources").get<Fac::Inventory>();
+
+        auto const &factories = j.at("gameState").at("factories");
+        r.factories.resize(factories.size());
+        pool.forEach(factories.size(), [&](size_t const i) {
+            auto const factory = std::make_shared<Fac::Factory>();
+            factories[i].get_to(*factory);
+            r.factories[i] = factory;
+        });
+        return r;
     }
 
     // All money the player has
     float credits = 10000.0;
 
     // All global resources the player has
-    std::map<Fac::Resource, int> resources = {};
+    Fac::Inventory resources = {};
 
+    // a stored factory is loaded first, nullptr if there is no factory with the id
     std::shared_ptr<Fac::Factory> getFactoryById(int const id) {
-        return *std::ranges::find_if(factories, [id](const auto &factory) {
+        auto const factory = std::ranges::find_if(factories, [id](const auto &factory) {
             return factory->getId() == id;
         });
+        return factory != factories.end() ? *factory : loadFactory(id);
     }
 
     void removeFactoryById(int const id) {
         factories.erase(std::ranges::remove_if(factories, [id](const auto &factory) {
             return factory->getId() == id;
         }).begin(), factories.end());
+        stored_factories.erase(std::ranges::remove(stored_factories, id, &StoredFactory::getId).begin(),
+                               stored_factories.end());
     }
 
     void addFactory(std::shared_ptr<Fac::Factory> const &factory) {
         factories.push_back(factory);
     }
 
+    // the loaded factories, these are the ones that are simulated
     std::vector<std::shared_ptr<Fac::Factory>> getFactories() {
         return factories;
     }
 
+    void addStoredFactory(StoredFactory factory) {
+        stored_factories.push_back(std::move(factory));
+    }
 
+    [[nodiscard]] std::vector<StoredFactory> const &getStoredFactories() const {
+        return stored_factories;
+    }
+
+    // removes the stored factories and hands them over
+    std::vector<StoredFactory> takeStoredFactories() {
+        return std::exchange(stored_factories, {});
+    }
+
+    // builds the stored factory with the id, nullptr if there is none
+    std::shared_ptr<Fac::Factory> loadFactory(int const id) {
+        auto const stored = std::ranges::find(stored_factories, id, &StoredFactory::getId);
+        if (stored == stored_factories.end()) {
+            return nullptr;
+        }
+        auto const factory = stored->load();
+        stored_factories.erase(stored);
+        factories.push_back(factory);
+        return factory;
+    }
+
+    // builds all stored factories, each one as a job on the pool
+    void loadFactories(ThreadPool &pool) {
+        std::vector<std::shared_ptr<Fac::Factory> > loaded(stored_factories.size());
+        pool.forEach(stored_factories.size(), [&](size_t const i) {
+            loaded[i] = stored_factories[i].load();
+        });
+        factories.insert(factories.end(), loaded.begin(), loaded.end());
+        stored_factories.clear();
+    }
+
+    // lets time pass for the stored factories, the loaded ones are stepped by the caller
+    void advanceStoredFactories(long const ms) {
+        for (auto &factory: stored_factories) {
+            factory.advance(ms);
+        }
+    }
 
 private:
-    // all factories the player owns
+    // all factories the player owns that are loaded
     std::vector<std::shared_ptr<Fac::Factory> > factories = {};
+    // the factories of the save that were not needed yet
+    std::vector<StoredFactory> stored_factories = {};
 };
 
 #endif //GAME_H
@@ -0,0 +1,412 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "game.h"
+#include "../binary.h"
+
+/**
+ * Journal
+ * -------
+ * Autosaves of a binary save append what changed since the previous save to a journal file next
+ * to the save, instead of rewriting the whole game state. An entry holds the credits, the
+ * resources, the ids of all factories with their stored time, and the entities of the loaded
+ * factories that were added, changed or removed, in the binary format.
+ *
+ * The journal keeps the encoding of every loaded factory as of the last save and compares the
+ * entities byte by byte. A changed entity is written as the runs of bytes that differ, e.g. its
+ * stack amounts and progress, or whole if that is shorter. A factory that was stored at the last
+ * save, or that is new, is written whole once, after that it gets deltas like the others. Every
+ * save still encodes all loaded factories, only what is written depends on the changes.
+ *
+ * A full save replaces the journal (compaction). It is due when the journal has grown to half the
+ * size of the save or to MAX_ENTRIES entries. Loading a save replays its journal on the stored
+ * factories without building them.
+ *
+ * Every entry starts with its size, an entry that was cut off by a crash is ignored.
+ */
+class Journal {
+public:
+    static constexpr std::string_view MAGIC = "FACJRNL";
+    static constexpr std::uint32_t VERSION = 2;
+    static constexpr int MAX_ENTRIES = 100;
+
+    // the next save has to be a full one
+    [[nodiscard]] bool needsCompaction() const {
+        return !_tracking || _entries >= MAX_ENTRIES || 2 * _journal_bytes > _save_bytes;
+    }
+
+    // forgets the state of the last save, e.g. when writing it failed
+    void clear() {
+        _tracking = false;
+        _factories.clear();
+        _save_bytes = 0;
+        _journal_bytes = 0;
+        _entries = 0;
+    }
+
+    // called for every loaded factory of a full save, entities are the ranges of its entities in its data
+    void track(StoredFactory const &factory, std::vector<Fac::BinaryEntityRange> const &entities) {
+        auto &tracked = _factories[factory.getId()];
+        tracked.stored_ms = factory.getStoredMs();
+        tracked.data = factory.getData();
+        tracked.entities.clear();
+        for (auto const &e: entities) {
+            tracked.entities[e.id] = {e.begin, e.end};
+        }
+    }
+
+    // called for every stored factory of a full save, it is written whole once it is loaded
+    void trackStored(StoredFactory const &factory) {
+        auto &tracked = _factories[factory.getId()];
+        tracked = TrackedFactory();
+        tracked.stored_ms = factory.getStoredMs();
+    }
+
+    // called once a full save with all its factories tracked is encoded
+    void tracked(size_t const save_bytes) {
+        _tracking = true;
+        _save_bytes = save_bytes;
+        _journal_bytes = 0;
+        _entries = 0;
+    }
+
+    // the changes since the last save as a journal entry, the state becomes the last save
+    std::vector<char> delta(GameState &state) {
+        auto w = Fac::BinaryWriter();
+        w.write(state.credits);
+        to_binary(w, state.resources);
+
+        auto const factories = state.getFactories();
+        auto const &stored_factories = state.getStoredFactories();
+        w.write(static_cast<std::uint32_t>(factories.size() + stored_factories.size()));
+        for (auto const &factory: factories) {
+            w.write(static_cast<std::int32_t>(factory->getId()));
+            w.write(static_cast<std::int64_t>(0));
+        }
+        for (auto const &factory: stored_factories) {
+            w.write(static_cast<std::int32_t>(factory.getId()));
+            w.write(static_cast<std::int64_t>(factory.getStoredMs()));
+        }
+
+        std::unordered_map<int, TrackedFactory> tracked;
+        auto changes = Fac::BinaryWriter();
+        std::uint32_t changed_factories = 0;
+        for (auto const &factory: factories) {
+            auto data = Fac::BinaryWriter();
+            auto const entities = writeFactory(data, *factory);
+            auto const previous = _factories.find(factory->getId());
+            // without the encoding of the last save, the factory replaces the one of the save
+            auto const replace = previous == _factories.end() || previous->second.data.empty();
+
+            auto &current = tracked[factory->getId()];
+            current.data = data.data();
+            auto const bytes_of = [](TrackedFactory const &f, std::pair<size_t, size_t> const &range) {
+                return std::span(f.data).subspan(range.first, range.second - range.first);
+            };
+
+            auto entries = Fac::BinaryWriter();
+            std::uint32_t changed = 0;
+            for (auto const &e: entities) {
+                current.entities[e.id] = {e.begin, e.end};
+                auto const bytes = bytes_of(current, {e.begin, e.end});
+                auto const before = replace ? nullptr : find(previous->second.entities, e.id);
+                if (before != nullptr && std::ranges::equal(bytes, bytes_of(previous->second, *before))) {
+                    continue;
+                }
+                changed++;
+                entries.write(static_cast<std::int32_t>(e.id));
+                writeEntity(entries, before != nullptr ? bytes_of(previous->second, *before) : std::span<char const>(),
+                            bytes);
+            }
+            std::vector<int> removed;
+            if (!replace) {
+                for (auto const &id: previous->second.entities | std::views::keys) {
+                    if (!current.entities.contains(id)) {
+                        removed.push_back(id);
+                    }
+                }
+            }
+            if (!replace && changed == 0 && removed.empty()) {
+                continue;
+            }
+
+            changed_factories++;
+            changes.write(static_cast<std::int32_t>(factory->getId()));
+            changes.write(static_cast<std::uint8_t>(replace));
+            to_binary(changes, Fac::Throughput(*factory).getProductionRpm(*factory));
+            changes.write(static_cast<std::uint32_t>(removed.size()));
+            for (auto const id: removed) {
+                changes.write(static_cast<std::int32_t>(id));
+            }
+            changes.write(changed);
+            changes.writeBytes(entries.data());
+        }
+        for (auto const &factory: stored_factories) {
+            tracked[factory.getId()].stored_ms = factory.getStoredMs();
+        }
+        _factories = std::move(tracked);
+
+        w.write(changed_factories);
+        w.writeBytes(changes.data());
+
+        auto entry = Fac::BinaryWriter();
+        entry.write(static_cast<std::uint64_t>(w.data().size()));
+        entry.writeBytes(w.data());
+        _journal_bytes += entry.data().size();
+        _entries++;
+        return entry.data();
+    }
+
+    // the start of a journal file
+    static std::vector<char> header() {
+        auto w = Fac::BinaryWriter();
+        w.writeBytes(MAGIC);
+        w.write(VERSION);
+        return w.data();
+    }
+
+    // applies the entries of a journal to the stored factories of the state that was decoded from its save
+    static void replay(std::span<char const> const journal, GameState &state) {
+        auto b = Fac::BinaryReader(journal);
+        if (journal.size() < MAGIC.size() || std::string_view(b.readBytes(MAGIC.size()).data(), MAGIC.size()) != MAGIC) {
+            throw std::runtime_error("Not a journal");
+        }
+        if (auto const version = b.read<std::uint32_t>(); version != VERSION) {
+            throw std::runtime_error("Unsupported journal version " + std::to_string(version));
+        }
+
+        // the entities of the saved factories, found when an entry changes them
+        std::unordered_map<int, std::vector<char> const *> saved_data;
+        for (auto const &factory: state.getStoredFactories()) {
+            saved_data[factory.getId()] = &factory.getData();
+        }
+        std::unordered_map<int, std::unordered_map<int, std::span<char const> > > saved_entities;
+        auto const saved_entity = [&](int const factory_id, int const entity_id) -> std::span<char const> {
+            auto const data = saved_data.find(factory_id);
+            if (data == saved_data.end()) {
+                return {};
+            }
+            auto [entities, added] = saved_entities.try_emplace(factory_id);
+            if (added) {
+                for (auto const &e: Fac::readEntityRanges(*data->second).second) {
+                    entities->second[e.id] = std::span(*data->second).subspan(e.begin, e.end - e.begin);
+                }
+            }
+            auto const entity = entities->second.find(entity_id);
+            return entity != entities->second.end() ? entity->second : std::span<char const>();
+        };
+
+        // the factories of the last entry with their stored time
+        std::vector<std::pair<int, long> > factories;
+        std::unordered_map<int, FactoryChanges> changes;
+        auto replayed = false;
+        while (journal.size() - b.getPosition() >= sizeof(std::uint64_t)) {
+            auto const size = b.read<std::uint64_t>();
+            if (journal.size() - b.getPosition() < size) {
+                break;
+            }
+            auto e = Fac::BinaryReader(b.readBytes(size));
+            state.credits = e.read<float>();
+            from_binary(e, state.resources);
+
+            factories.resize(e.read<std::uint32_t>());
+            for (auto &[id, stored_ms]: factories) {
+                id = e.read<std::int32_t>();
+                stored_ms = e.read<std::int64_t>();
+            }
+
+            auto const changed_factories = e.read<std::uint32_t>();
+            for (std::uint32_t i = 0; i < changed_factories; i++) {
+                auto const id = e.read<std::int32_t>();
+                auto &factory = changes[id];
+                if (e.read<std::uint8_t>() != 0) {
+                    factory = FactoryChanges();
+                    factory.replaced = true;
+                }
+                from_binary(e, factory.production_rpm);
+                auto const removed = e.read<std::uint32_t>();
+                for (std::uint32_t j = 0; j < removed; j++) {
+                    factory.entities[e.read<std::int32_t>()].clear();
+                }
+                auto const changed = e.read<std::uint32_t>();
+                for (std::uint32_t j = 0; j < changed; j++) {
+                    auto const entity_id = e.read<std::int32_t>();
+                    auto [entity, added] = factory.entities.try_emplace(entity_id);
+                    if (added) {
+                        factory.added.push_back(entity_id);
+                    }
+                    auto const base = !entity->second.empty() || factory.replaced
+                                          ? std::span<char const>(entity->second)
+                                          : saved_entity(id, entity_id);
+                    entity->second = readEntity(e, base);
+                }
+            }
+            replayed = true;
+        }
+        if (!replayed) {
+            return;
+        }
+
+        auto stored = state.takeStoredFactories();
+        std::unordered_map<int, StoredFactory *> saved;
+        for (auto &factory: stored) {
+            saved[factory.getId()] = &factory;
+        }
+        for (auto const &[id, stored_ms]: factories) {
+            auto const base = saved.find(id);
+            auto const changed = changes.find(id);
+            if (changed == changes.end()) {
+                if (base != saved.end()) {
+                    base->second->setStoredMs(stored_ms);
+                    state.addStoredFactory(std::move(*base->second));
+                }
+                continue;
+            }
+            auto const &entities = changed->second.entities;
+            std::vector<std::span<char const> > parts;
+            std::unordered_set<int> in_base;
+            if (base != saved.end() && !changed->second.replaced) {
+                auto const &data = base->second->getData();
+                for (auto const &e: Fac::readEntityRanges(data).second) {
+                    in_base.insert(e.id);
+                    auto const entity = entities.find(e.id);
+                    if (entity == entities.end()) {
+                        parts.push_back(std::span(data).subspan(e.begin, e.end - e.begin));
+                    } else if (!entity->second.empty()) {
+                        parts.push_back(entity->second);
+                    }
+                }
+            }
+            for (auto const entity_id: changed->second.added) {
+                if (auto const &bytes = entities.at(entity_id); !in_base.contains(entity_id) && !bytes.empty()) {
+                    parts.push_back(bytes);
+                }
+            }
+
+            auto w = Fac::BinaryWriter();
+            w.write(static_cast<std::int32_t>(id));
+            w.write(static_cast<std::uint32_t>(parts.size()));
+            for (auto const &bytes: parts) {
+                w.writeBytes(bytes);
+            }
+            state.addStoredFactory(StoredFactory(id, stored_ms, changed->second.production_rpm, w.data()));
+        }
+    }
+
+private:
+    struct TrackedFactory {
+        long stored_ms = 0;
+        // the encoding of the factory at the last save, empty for a factory that is stored
+        std::vector<char> data;
+        // the range of every entity in data
+        std::unordered_map<int, std::pair<size_t, size_t> > entities;
+    };
+
+    // what the entries of a journal changed in one factory
+    struct FactoryChanges {
+        // the factory was written whole, the entities of the save are dropped
+        bool replaced = false;
+        Fac::ResourceArray<double> production_rpm;
+        // the latest encoding of every changed entity, empty if it was removed
+        std::unordered_map<int, std::vector<char> > entities;
+        // the changed entities in the order they first changed, the new ones are added in this order
+        std::vector<int> added;
+    };
+
+    // how an entity is written: whole, or the runs of bytes that differ from its previous encoding
+    enum class EntityFormat : std::uint8_t {
+        Whole,
+        Patch,
+    };
+
+    // runs of equal bytes shorter than the header of a run are written as part of the runs around them
+    static constexpr size_t RUN_HEADER_BYTES = 2 * sizeof(std::uint32_t);
+
+    static std::pair<size_t, size_t> const *find(std::unordered_map<int, std::pair<size_t, size_t> > const &entities,
+                                                 int const id) {
+        auto const entity = entities.find(id);
+        return entity != entities.end() ? &entity->second : nullptr;
+    }
+
+    // writes the entity as a patch of before if that is shorter, before is empty for a new entity
+    static void writeEntity(Fac::BinaryWriter &w, std::span<char const> const before, std::span<char const> const after) {
+        std::vector<std::pair<size_t, size_t> > runs;
+        if (before.size() == after.size()) {
+            for (size_t i = 0; i < after.size();) {
+                if (before[i] == after[i]) {
+                    i++;
+                    continue;
+                }
+                auto end = i + 1;
+                for (auto equal = 0uz; end < after.size() && equal < RUN_HEADER_BYTES; end++) {
+                    equal = before[end] == after[end] ? equal + 1 : 0;
+                }
+                // the run ends at its last differing byte
+                while (before[end - 1] == after[end - 1]) {
+                    end--;
+                }
+                runs.emplace_back(i, end);
+                i = end;
+            }
+        }
+        auto patch_bytes = sizeof(std::uint32_t);
+        for (auto const &[begin, end]: runs) {
+            patch_bytes += RUN_HEADER_BYTES + end - begin;
+        }
+        if (before.size() != after.size() || patch_bytes >= after.size()) {
+            w.write(static_cast<std::uint8_t>(EntityFormat::Whole));
+            w.write(static_cast<std::uint32_t>(after.size()));
+            w.writeBytes(after);
+            return;
+        }
+        w.write(static_cast<std::uint8_t>(EntityFormat::Patch));
+        w.write(static_cast<std::uint32_t>(runs.size()));
+        for (auto const &[begin, end]: runs) {
+            w.write(static_cast<std::uint32_t>(begin));
+            w.write(static_cast<std::uint32_t>(end - begin));
+            w.writeBytes(after.subspan(begin, end - begin));
+        }
+    }
+
+    // reads an entity written by writeEntity, before is its previous encoding
+    static std::vector<char> readEntity(Fac::BinaryReader &b, std::span<char const> const before) {
+        if (static_cast<EntityFormat>(b.read<std::uint8_t>()) == EntityFormat::Whole) {
+            auto const bytes = b.readBytes(b.read<std::uint32_t>());
+            return {bytes.begin(), bytes.end()};
+        }
+        if (before.empty()) {
+            throw std::runtime_error("Journal does not match its save");
+        }
+        std::vector<char> result(before.begin(), before.end());
+        auto const runs = b.read<std::uint32_t>();
+        for (std::uint32_t i = 0; i < runs; i++) {
+            auto const begin = b.read<std::uint32_t>();
+            auto const bytes = b.readBytes(b.read<std::uint32_t>());
+            if (begin + bytes.size() > result.size()) {
+                throw std::runtime_error("Journal does not match its save");
+            }
+            std::ranges::copy(bytes, result.begin() + begin);
+        }
+        return result;
+    }
+
+    // the state of the last save is known, deltas can be written
+    bool _tracking = false;
+    std::unordered_map<int, TrackedFactory> _factories;
+    size_t _save_bytes = 0;
+    // written since the last full save
+    size_t _journal_bytes = 0;
+    int _entries = 0;
+};
+
+#endif //JOURNAL_H
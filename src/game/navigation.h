@@ -2,6 +2,7 @@
 #define NAVIGATION_H
 #include <functional>
 #include <map>
+#include <variant>
 
 enum WindowType {
     OVERVIEW,
@@ -0,0 +1,178 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "journal.h"
+#include "../binary.h"
+#include "../tools/mapped_file.h"
+
+// Saves are binary, unless the file name ends with .json. JSON stays available as an export format.
+inline bool isJsonSaveFile(std::string const &file) {
+    return file.ends_with(".json");
+}
+
+// the journal, if given, tracks the factories as they are written
+inline void to_binary(Fac::BinaryWriter &w, GameState &state, Journal *journal = nullptr) {
+    w.write(state.credits);
+    to_binary(w, state.resources);
+    // every factory is a chunk, the stored ones are written as they are
+    auto const factories = state.getFactories();
+    auto const &stored_factories = state.getStoredFactories();
+    w.write(static_cast<std::uint32_t>(factories.size() + stored_factories.size()));
+    std::vector<Fac::BinaryEntityRange> entities;
+    for (auto const &factory: factories) {
+        auto const stored = StoredFactory::of(*factory, journal != nullptr ? &entities : nullptr);
+        if (journal != nullptr) {
+            journal->track(stored, entities);
+        }
+        to_binary(w, stored);
+    }
+    for (auto const &factory: stored_factories) {
+        if (journal != nullptr) {
+            journal->trackStored(factory);
+        }
+        to_binary(w, factory);
+    }
+}
+
+inline void from_binary(Fac::BinaryReader &b, GameState &state) {
+    state.credits = b.read<float>();
+    from_binary(b, state.resources);
+    // the factories stay stored, see GameState::loadFactory
+    auto const factories = b.read<std::uint32_t>();
+    for (std::uint32_t i = 0; i < factories; i++) {
+        auto factory = StoredFactory();
+        from_binary(b, factory);
+        state.addStoredFactory(std::move(factory));
+    }
+}
+
+// a full save, the journal (if given) continues from it
+inline std::vector<char> encodeGameState(GameState &state, Journal *journal = nullptr) {
+    auto w = Fac::BinaryWriter();
+    w.writeHeader();
+    if (journal != nullptr) {
+        journal->clear();
+    }
+    to_binary(w, state, journal);
+    if (journal != nullptr) {
+        journal->tracked(w.data().size());
+    }
+    return w.data();
+}
+
+inline GameState decodeGameState(std::span<char const> const data) {
+    auto b = Fac::BinaryReader(data);
+    b.readHeader();
+    auto state = GameState();
+    from_binary(b, state);
+    return state;
+}
+
+// the changes since the last full save of a binary save file, see Journal
+inline std::string journalFileOf(std::string const &file) {
+    return file + ".journal";
+}
+
+// writes next to the file and renames, so the file is never left half written. write fills the
+// file, before_rename runs once it is written completely
+inline void writeFileAtomically(std::string const &file, std::function<void(std::ostream &)> const &write,
+                                std::function<void()> const &before_rename = {}) {
+    auto const temp_file = file + ".tmp";
+    {
+        std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Could not open file: " + temp_file);
+        }
+        write(out);
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Could not write file: " + temp_file);
+        }
+    }
+    if (before_rename) {
+        before_rename();
+    }
+    std::filesystem::rename(temp_file, file);
+}
+
+inline void writeFileAtomically(std::string const &file, std::span<char const> const data,
+                                std::function<void()> const &before_rename = {}) {
+    writeFileAtomically(file, [data](std::ostream &out) {
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }, before_rename);
+}
+
+// a full binary save replaces the journal. The journal is removed before the save is renamed, a
+// crash in between leaves the previous save without its latest changes, but never a journal
+// that does not belong to its save
+inline void writeBinarySave(std::string const &file, std::span<char const> const data) {
+    writeFileAtomically(file, data, [&file] { std::filesystem::remove(journalFileOf(file)); });
+}
+
+// appends an entry of Journal::delta to the journal of the save file
+inline void appendToJournal(std::string const &file, std::span<char const> const entry) {
+    auto const journal_file = journalFileOf(file);
+    auto const is_new = !std::filesystem::exists(journal_file);
+    std::ofstream out(journal_file, std::ios::binary | std::ios::app);
+    if (!out) {
+        throw std::runtime_error("Could not open file: " + journal_file);
+    }
+    if (is_new) {
+        auto const header = Journal::header();
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    }
+    out.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Could not write file: " + journal_file);
+    }
+}
+
+// reads a binary or a JSON save, the format is detected from the content. A binary save gets the
+// changes of its journal, its factories stay stored until they are needed. The factories of a
+// JSON save are built on the pool.
+inline GameState loadGameStateLazily(std::string const &file, ThreadPool &pool) {
+    auto const mapped = MappedFile(file);
+    if (Fac::isBinarySave(mapped.data())) {
+        auto state = decodeGameState(mapped.data());
+        if (auto const journal_file = journalFileOf(file); std::filesystem::exists(journal_file)) {
+            Journal::replay(MappedFile(journal_file).data(), state);
+        }
+        return state;
+    }
+    return GameState::fromJson(json::parse(mapped.data().begin(), mapped.data().end()), pool);
+}
+
+// reads a save with all factories built, on the pool
+inline GameState loadGameState(std::string const &file, ThreadPool &pool) {
+    auto state = loadGameStateLazily(file, pool);
+    state.loadFactories(pool);
+    return state;
+}
+
+inline GameState loadGameState(std::string const &file) {
+    auto pool = ThreadPool();
+    return loadGameState(file, pool);
+}
+
+inline void saveGameState(GameState &state, std::string const &file) {
+    if (isJsonSaveFile(file)) {
+        // streamed, a document of a big state would need several times the size of the file
+        writeFileAtomically(file, [&state](std::ostream &out) {
+            writeJson(out, state);
+            out << "\n";
+        });
+    } else {
+        writeBinarySave(file, encodeGameState(state));
+    }
+}
+
+#endif //SAVE_H
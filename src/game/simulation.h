@@ -0,0 +1,147 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "autosave.h"
+#include "game.h"
+#include "snapshot.h"
+#include "../tools/thread_pool.h"
+
+/**
+ * Simulation
+ * ----------
+ * Runs the factories of a GameState on its own thread with a fixed tick rate, independent of the
+ * frame rate. Stored factories only get the time of every tick, until a command loads them.
+ *
+ * The render thread reads the latest GameSnapshot without locking and without touching the game
+ * state. A new one is only built after a tick once the previous one was read, so at most one per
+ * frame and none while nothing is rendered.
+ *
+ * The game state belongs to the simulation thread while it runs. Changes, e.g. from the windows,
+ * are posted as commands and run between two ticks. An Autosave takes its snapshots between two
+ * ticks as well.
+ */
+class Simulation {
+public:
+    static constexpr int TICK_MS = 10;
+
+    // a simulation that falls further behind skips the time instead of catching up
+    static constexpr auto MAX_LAG = std::chrono::milliseconds(250);
+
+    explicit Simulation(GameState &state, std::shared_ptr<ThreadPool> pool): _state(state), _pool(std::move(pool)) {
+        publish();
+    }
+
+    Simulation(Simulation const &) = delete;
+
+    Simulation &operator=(Simulation const &) = delete;
+
+    ~Simulation() { stop(); }
+
+    void start() {
+        if (!_thread.joinable()) {
+            _thread = std::jthread([this](std::stop_token const &stop_token) { run(stop_token); });
+        }
+    }
+
+    // waits for the current tick and runs the remaining commands, the game state belongs to the caller again
+    void stop() {
+        if (_thread.joinable()) {
+            _thread.request_stop();
+            _thread.join();
+        }
+    }
+
+    // must be set before the simulation starts
+    void setAutosave(std::shared_ptr<Autosave> autosave) {
+        _autosave = std::move(autosave);
+    }
+
+    // runs the command on the simulation thread between two ticks
+    void post(std::function<void(GameState &)> command) {
+        std::lock_guard lock(_commands_mutex);
+        _commands.push_back(std::move(command));
+    }
+
+    [[nodiscard]] std::shared_ptr<GameSnapshot const> getSnapshot() const {
+        auto snapshot = _snapshot.load(std::memory_order_acquire);
+        _snapshot_read.store(true, std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    [[nodiscard]] int getSnapshotsPublished() const { return _snapshots_published; }
+
+private:
+    void run(std::stop_token const &stop_token) {
+        using Clock = std::chrono::steady_clock;
+        auto next_tick = Clock::now();
+
+        while (!stop_token.stop_requested()) {
+            runCommands();
+            tick();
+            if (_snapshot_read.exchange(false, std::memory_order_relaxed)) {
+                publish();
+            }
+            if (_autosave) {
+                _autosave->update(_state);
+            }
+
+            next_tick += std::chrono::milliseconds(TICK_MS);
+            if (auto const now = Clock::now(); now - next_tick > MAX_LAG) {
+                next_tick = now;
+            }
+            std::this_thread::sleep_until(next_tick);
+        }
+        runCommands();
+        publish();
+    }
+
+    void runCommands() {
+        std::vector<std::function<void(GameState &)> > commands;
+        {
+            std::lock_guard lock(_commands_mutex);
+            commands.swap(_commands);
+        }
+        for (auto const &command: commands) {
+            command(_state);
+        }
+    }
+
+    void tick() const {
+        _state.advanceStoredFactories(TICK_MS);
+        auto const factories = _state.getFactories();
+        for (auto const &factory: factories) {
+            if (factory->getThreadPool() != _pool) {
+                factory->setThreadPool(_pool);
+            }
+        }
+        _pool->forEach(factories.size(), [&factories](size_t const i) {
+            factories[i]->step(TICK_MS);
+        });
+    }
+
+    void publish() {
+        _snapshots_published++;
+        _snapshot.store(std::make_shared<GameSnapshot const>(GameSnapshot::of(_state)), std::memory_order_release);
+    }
+
+    GameState &_state;
+    std::shared_ptr<ThreadPool> _pool;
+    std::shared_ptr<Autosave> _autosave;
+    std::mutex _commands_mutex;
+    std::vector<std::function<void(GameState &)> > _commands;
+    std::atomic<std::shared_ptr<GameSnapshot const> > _snapshot;
+    // the render thread has read the latest snapshot, the next tick publishes a new one
+    mutable std::atomic<bool> _snapshot_read = false;
+    std::atomic<int> _snapshots_published = 0;
+    // declared last, so the thread is stopped before the members it uses are destroyed
+    std::jthread _thread;
+};
+
+#endif //SIMULATION_H
@@ -0,0 +1,137 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include "game.h"
+#include "../factory.h"
+
+// Immutable copies of everything the windows show. The simulation thread creates them after its
+// ticks, the render thread reads them without touching the entities.
+
+struct ResourceNodeSnapshot {
+    int id;
+    Fac::Resource resource;
+    Fac::ResourceQuality quality;
+    // the extractor working on this node, -1 if there is none
+    int extractor_id = -1;
+};
+
+struct ExtractorSnapshot {
+    int id;
+    bool has_resource_node;
+    bool extracting;
+    double extraction_progress;
+    Fac::Resource resource;
+    float output_rpm;
+    int output_amount;
+};
+
+struct MachineSnapshot {
+    int id;
+    bool processing;
+    // 0 to 1
+    double progress;
+    std::optional<Fac::Resource> product;
+    std::vector<int> input_amounts;
+    std::vector<int> output_amounts;
+    int input_rpm;
+};
+
+struct FactorySnapshot {
+    int id;
+    // false for a stored factory, it has no entities to show until it is loaded
+    bool loaded = true;
+    std::vector<ResourceNodeSnapshot> resource_nodes;
+    std::vector<ExtractorSnapshot> extractors;
+    std::vector<MachineSnapshot> machines;
+
+    static FactorySnapshot of(Fac::Factory const &factory) {
+        auto result = FactorySnapshot();
+        result.id = factory.getId();
+
+        std::map<int, int> extractor_of_node;
+        for (auto const &e: factory.getEntityArray<Fac::Extractor>()) {
+            if (e->hasResourceNode()) {
+                extractor_of_node[e->getResourceNode()->getId()] = e->getId();
+            }
+            result.extractors.push_back({
+                .id = e->getId(),
+                .has_resource_node = e->hasResourceNode(),
+                .extracting = e->extracting,
+                .extraction_progress = e->extraction_progress,
+                .resource = e->getResourceNode()->getResource(),
+                .output_rpm = e->getOutputRpm(),
+                .output_amount = e->getOutputStack(0)->getAmount(),
+            });
+        }
+
+        for (auto const &n: factory.getEntityArray<Fac::ResourceNode>()) {
+            auto const extractor = extractor_of_node.find(n->getId());
+            result.resource_nodes.push_back({
+                .id = n->getId(),
+                .resource = n->getResource(),
+                .quality = n->getQuality(),
+                .extractor_id = extractor != extractor_of_node.end() ? extractor->second : -1,
+            });
+        }
+
+        for (auto const &m: factory.getEntityArray<Fac::Machine>()) {
+            auto machine = MachineSnapshot();
+            machine.id = m->getId();
+            machine.processing = m->processing;
+            machine.progress = 0;
+            machine.input_rpm = m->getInputRpm();
+            if (auto const &recipe = m->getRecipe(); recipe.has_value()) {
+                if (recipe->processing_time_s > 0) {
+                    machine.progress = m->processing_progress / (recipe->processing_time_s * 1000);
+                }
+                if (!recipe->products.empty()) {
+                    machine.product = recipe->products.front().resource;
+                }
+            }
+            for (int i = 0; i < m->getInputSlots(); i++) {
+                machine.input_amounts.push_back(m->getInputStack(i)->getAmount());
+            }
+            for (int i = 0; i < m->getOutputSlots(); i++) {
+                machine.output_amounts.push_back(m->getOutputStack(i)->getAmount());
+            }
+            result.machines.push_back(std::move(machine));
+        }
+        return result;
+    }
+};
+
+struct GameSnapshot {
+    float credits = 0;
+    Fac::Inventory resources;
+    std::vector<FactorySnapshot> factories;
+
+    static GameSnapshot of(GameState &state) {
+        auto result = GameSnapshot();
+        result.credits = state.credits;
+        result.resources = state.resources;
+        for (auto const &factory: state.getFactories()) {
+            result.factories.push_back(FactorySnapshot::of(*factory));
+        }
+        for (auto const &factory: state.getStoredFactories()) {
+            auto stored = FactorySnapshot();
+            stored.id = factory.getId();
+            stored.loaded = false;
+            result.factories.push_back(std::move(stored));
+        }
+        // loading a factory must not move it in the lists of the windows
+        std::ranges::sort(result.factories, {}, &FactorySnapshot::id);
+        return result;
+    }
+
+    [[nodiscard]] FactorySnapshot const *getFactoryById(int const id) const {
+        auto const factory = std::ranges::find(factories, id, &FactorySnapshot::id);
+        return factory != factories.end() ? &*factory : nullptr;
+    }
+};
+
+#endif //SNAPSHOT_H
@@ -0,0 +1,177 @@
+#ifndef STORED_FACTORY_H
+#define STORED_FACTORY_H
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../binary.h"
+#include "../throughput.h"
+
+/**
+ * StoredFactory
+ * -------------
+ * A factory of a binary save that stays encoded until it is needed. Most factories of a big save
+ * are never opened in a session, those are neither built nor simulated tick by tick.
+ *
+ * While stored, the time that passes is only added up and the production is estimated from the
+ * steady state rates (see Throughput) the factory had when it was encoded. load builds the
+ * factory when it is opened or an exact state is needed. Only the last MAX_REPLAY_MS of the
+ * stored time are simulated, the production of the time before is credited from the estimate.
+ * The goods of that time are extrapolated from what the second half of the simulated time added to
+ * the storages and to the outputs of machines and extractors, as far as they have room.
+ *
+ * In a save, every factory is one chunk: its id, the stored time, the rates and the size of the
+ * encoded factory, so a reader can keep or skip it without decoding it.
+ */
+class StoredFactory {
+public:
+    // simulating an hour of a big factory takes minutes, the time before is estimated
+    static constexpr long MAX_REPLAY_MS = 10'000;
+
+    StoredFactory() = default;
+
+    StoredFactory(int const id, long const stored_ms, Fac::ResourceArray<double> const &production_rpm,
+                  std::vector<char> data)
+        : _id(id), _stored_ms(stored_ms), _production_rpm(production_rpm), _data(std::move(data)) {
+    }
+
+    // encodes the factory as it is now, optionally with the ranges of its entities in getData
+    static StoredFactory of(Fac::Factory const &factory, std::vector<Fac::BinaryEntityRange> *entities = nullptr) {
+        auto w = Fac::BinaryWriter();
+        auto ranges = writeFactory(w, factory);
+        if (entities != nullptr) {
+            *entities = std::move(ranges);
+        }
+        return {factory.getId(), 0, Fac::Throughput(factory).getProductionRpm(factory), w.data()};
+    }
+
+    [[nodiscard]] int getId() const { return _id; }
+
+    // the factory in the binary format
+    [[nodiscard]] std::vector<char> const &getData() const { return _data; }
+
+    [[nodiscard]] Fac::ResourceArray<double> const &getProductionRpm() const { return _production_rpm; }
+
+    // lets time pass without simulating it
+    void advance(long const ms) { _stored_ms += ms; }
+
+    // the time that passed since the factory was encoded
+    [[nodiscard]] long getStoredMs() const { return _stored_ms; }
+
+    void setStoredMs(long const ms) { _stored_ms = ms; }
+
+    // the estimated production while stored, per resource
+    [[nodiscard]] Fac::ResourceArray<long> getProductionTotals() const {
+        return estimateProduction(_stored_ms);
+    }
+
+    // builds the factory and catches up on the time that passed while it was stored: the last
+    // MAX_REPLAY_MS are simulated, the production of the time before is credited to the factory
+    // and its goods are extrapolated from the simulated time
+    [[nodiscard]] std::shared_ptr<Fac::Factory> load() const {
+        auto const factory = build();
+        auto const estimated_ms = std::max(0L, _stored_ms - MAX_REPLAY_MS);
+        auto const replayed_ms = _stored_ms - estimated_ms;
+        factory->creditProduction(estimateProduction(estimated_ms));
+        if (replayed_ms == 0) {
+            return factory;
+        }
+        // the factory starts up again in the first half, the second half shows what it gains over time
+        auto const warm_up_ms = replayed_ms / 2;
+        factory->step(warm_up_ms);
+        auto const goods = Goods(*factory);
+        factory->step(replayed_ms - warm_up_ms);
+        if (estimated_ms > 0) {
+            goods.extrapolate(static_cast<double>(estimated_ms) / static_cast<double>(replayed_ms - warm_up_ms));
+        }
+        return factory;
+    }
+
+    // builds the factory as it was encoded, without the stored time
+    [[nodiscard]] std::shared_ptr<Fac::Factory> build() const {
+        auto const factory = std::make_shared<Fac::Factory>();
+        auto b = Fac::BinaryReader(_data);
+        from_binary(b, *factory);
+        return factory;
+    }
+
+    friend void to_binary(Fac::BinaryWriter &w, StoredFactory const &r) {
+        w.write(static_cast<std::int32_t>(r._id));
+        w.write(static_cast<std::int64_t>(r._stored_ms));
+        to_binary(w, r._production_rpm);
+        w.write(static_cast<std::uint64_t>(r._data.size()));
+        w.writeBytes(r._data);
+    }
+
+    friend void from_binary(Fac::BinaryReader &b, StoredFactory &r) {
+        r._id = b.read<std::int32_t>();
+        r._stored_ms = b.read<std::int64_t>();
+        from_binary(b, r._production_rpm);
+        auto const bytes = b.readBytes(b.read<std::uint64_t>());
+        r._data.assign(bytes.begin(), bytes.end());
+    }
+
+private:
+    // the content of the storages and the output stacks of the machines and extractors of a factory
+    class Goods {
+    public:
+        explicit Goods(Fac::Factory const &factory) {
+            for (auto const &s: factory.getEntityArray<Fac::Storage>()) {
+                _storages.emplace_back(s, s->getInventory());
+            }
+            for (auto const &m: factory.getEntityArray<Fac::Machine>()) {
+                for (int i = 0; i < m->getOutputSlots(); i++) {
+                    _stacks.emplace_back(m->getOutputStack(i), m->outputStack(i).getAmount());
+                }
+            }
+            for (auto const &e: factory.getEntityArray<Fac::Extractor>()) {
+                _stacks.emplace_back(e->getOutputStack(0), e->outputStack(0).getAmount());
+            }
+        }
+
+        // adds what was gained since the goods were taken, times the factor, as far as there is room
+        void extrapolate(double const factor) const {
+            for (auto const &[storage, before]: _storages) {
+                storage->getInventory().forEach([&](Fac::Resource const r, int const amount) {
+                    if (amount > before[r]) {
+                        storage->storeAmount(scale(amount - before[r], factor), r);
+                    }
+                });
+            }
+            for (auto const &[stack, before]: _stacks) {
+                if (auto const gained = stack->getAmount() - before; gained > 0) {
+                    auto const r = stack->getResource();
+                    stack->addAmount(std::min(scale(gained, factor), stack->getRoom(r)), r);
+                }
+            }
+        }
+
+    private:
+        static int scale(int const amount, double const factor) {
+            return static_cast<int>(std::min(amount * factor, static_cast<double>(std::numeric_limits<int>::max())));
+        }
+
+        std::vector<std::pair<std::shared_ptr<Fac::Storage>, Fac::Inventory> > _storages;
+        std::vector<std::pair<std::shared_ptr<Fac::Stack>, int> > _stacks;
+    };
+
+    [[nodiscard]] Fac::ResourceArray<long> estimateProduction(long const ms) const {
+        Fac::ResourceArray<long> totals;
+        _production_rpm.forEach([&](Fac::Resource const resource, double const rpm) {
+            totals[resource] = static_cast<long>(rpm * static_cast<double>(ms) / 60000);
+        });
+        return totals;
+    }
+
+    int _id = 0;
+    long _stored_ms = 0;
+    // the steady state production when the factory was encoded
+    Fac::ResourceArray<double> _production_rpm;
+    // the factory in the binary format
+    std::vector<char> _data;
+};
+
+#endif //STORED_FACTORY_H
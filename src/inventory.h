@@ -0,0 +1,84 @@
+#ifndef INVENTORY_H
+#define INVENTORY_H
+
+#include <array>
+#include <concepts>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+#include "autogenerated/resources.h"
+
+using json = nlohmann::json;
+
+namespace Fac {
+    /**
+     * ResourceArray
+     * -------------
+     * One value for every resource, stored in a plain array and indexed by the resource.
+     * Resources that were never set have a default constructed value.
+     */
+    template<typename T>
+    class ResourceArray {
+    public:
+        constexpr T &operator[](Resource const r) { return _values[static_cast<std::size_t>(r)]; }
+
+        constexpr T const &operator[](Resource const r) const { return _values[static_cast<std::size_t>(r)]; }
+
+        constexpr auto begin() { return _values.begin(); }
+        constexpr auto end() { return _values.end(); }
+        constexpr auto begin() const { return _values.begin(); }
+        constexpr auto end() const { return _values.end(); }
+
+        // calls f(resource, value) for every resource, in the order of the enum
+        template<typename F>
+        constexpr void forEach(F &&f) const {
+            for (std::size_t i = 0; i < RESOURCE_COUNT; i++) {
+                f(static_cast<Resource>(i), _values[i]);
+            }
+        }
+
+        constexpr ResourceArray &operator+=(ResourceArray const &other) requires std::is_arithmetic_v<T> {
+            // a plain loop over both arrays, so the compiler can vectorize it
+            for (std::size_t i = 0; i < RESOURCE_COUNT; i++) {
+                _values[i] += other._values[i];
+            }
+            return *this;
+        }
+
+        constexpr friend ResourceArray operator+(ResourceArray a, ResourceArray const &b) requires std::is_arithmetic_v<T> {
+            a += b;
+            return a;
+        }
+
+        constexpr bool operator==(ResourceArray const &other) const requires std::equality_comparable<T> {
+            return _values == other._values;
+        }
+
+    private:
+        std::array<T, RESOURCE_COUNT> _values{};
+    };
+
+    // amounts of items per resource
+    using Inventory = ResourceArray<int>;
+
+    // saved as the [resource, amount] pairs of the resources that are present, like the map it replaced
+    inline void to_json(json &j, Inventory const &r) {
+        j = json::array();
+        r.forEach([&j](Resource const resource, int const amount) {
+            if (amount != 0) {
+                j.push_back(json::array({resource, amount}));
+            }
+        });
+    }
+
+    inline void from_json(json const &j, Inventory &r) {
+        r = Inventory();
+        for (auto const &entry: j) {
+            auto const resource = entry.at(0).get<int>();
+            if (resource >= 0 && static_cast<std::size_t>(resource) < RESOURCE_COUNT) {
+                r[static_cast<Resource>(resource)] = entry.at(1).get<int>();
+            }
+        }
+    }
+}
+
+#endif //INVENTORY_H
@@ -0,0 +1,137 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace Fac;
+
+void Scheduler::rebuild(std::vector<GameWorldEntity *> const &entities) {
+    clear();
+    _entities = entities;
+    _states.reserve(_entities.size());
+    for (int slot = 0; slot < _entities.size(); slot++) {
+        auto const &state = _entities[slot]->getSleepState();
+        state->awake_slots = _awake;
+        state->slot = slot;
+        state->sleeping = false;
+        _states.push_back(state);
+    }
+    _last_update.assign(_entities.size(), _time);
+    _generation.assign(_entities.size(), 0);
+    _awake->bits.assign((_entities.size() + 63) / 64, 0);
+    wakeAll();
+    _needs_rebuild = false;
+}
+
+void Scheduler::clear() {
+    _entities.clear();
+    _states.clear();
+    _last_update.clear();
+    _generation.clear();
+    // entities that are not part of the schedule anymore must not wake up a slot of a new schedule
+    _awake = std::make_shared<AwakeSlots>();
+    _timers = {};
+    _needs_rebuild = true;
+}
+
+void Scheduler::wakeAll() {
+    for (auto const &state: _states) {
+        state->sleeping = false;
+    }
+    for (int word = 0; word < _awake->bits.size(); word++) {
+        auto const remaining = static_cast<int>(_entities.size()) - word * 64;
+        _awake->bits[word] = remaining >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << remaining) - 1;
+    }
+    _timers = {};
+}
+
+void Scheduler::update(double const dt) {
+    _time += dt;
+
+    while (!_timers.empty() && _timers.top().time <= _time) {
+        auto const timer = _timers.top();
+        _timers.pop();
+        if (_generation[timer.slot] == timer.generation) {
+            _states[timer.slot]->wake();
+        }
+    }
+
+    // Walk the awake slots in order. A slot that is woken up while the tick is running is
+    // still updated in this tick if it comes later in the order, just like every entity
+    // would see the change when all of them are updated each tick.
+    auto &bits = _awake->bits;
+    for (int word = 0; word < bits.size(); word++) {
+        auto from = 0;
+        while (from < 64) {
+            auto const pending = bits[word] & (~std::uint64_t{0} << from);
+            if (pending == 0) {
+                break;
+            }
+            auto const bit = std::countr_zero(pending);
+            bits[word] &= ~(std::uint64_t{1} << bit);
+            from = bit + 1;
+            updateSlot(word * 64 + bit);
+        }
+    }
+}
+
+void Scheduler::run(long ticks) {
+    while (ticks > 0) {
+        if (!anyAwake()) {
+            if (_timers.empty()) {
+                // everything sleeps until something changes from outside
+                _time += static_cast<double>(ticks);
+                return;
+            }
+            // skip the idle ticks, the last one is the tick in which the next timer fires
+            auto const idle = static_cast<long>(std::ceil(_timers.top().time - _time)) - 1;
+            auto const skipped = std::clamp(idle, 0L, ticks);
+            _time += static_cast<double>(skipped);
+            ticks -= skipped;
+            if (ticks == 0) {
+                return;
+            }
+        }
+        update(1);
+        ticks--;
+    }
+}
+
+bool Scheduler::anyAwake() const {
+    return std::ranges::any_of(_awake->bits, [](auto const word) { return word != 0; });
+}
+
+void Scheduler::updateSlot(int const slot) {
+    auto const entity = _entities[slot];
+    auto const elapsed = _time - _last_update[slot];
+    _last_update[slot] = _time;
+    entity->update(elapsed);
+    sleep(slot, entity->getSleepTime());
+}
+
+void Scheduler::sleep(int const slot, double const sleep_time) {
+    if (sleep_time <= 0) {
+        // stays awake for the next tick
+        _awake->set(slot);
+        return;
+    }
+
+    auto const &state = _states[slot];
+    state->sleeping = true;
+    _generation[slot]++;
+    _entities[slot]->watchStacks(state);
+    if (sleep_time != SLEEP_FOREVER) {
+        _timers.push({_last_update[slot] + sleep_time, slot, _generation[slot]});
+    }
+}
+
+void Scheduler::sync() {
+    for (int slot = 0; slot < _entities.size(); slot++) {
+        if (_states[slot]->sleeping && _last_update[slot] < _time) {
+            // the update only adds up the elapsed time, the entity keeps sleeping
+            _entities[slot]->update(_time - _last_update[slot]);
+            _last_update[slot] = _time;
+        }
+    }
+}
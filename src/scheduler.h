@@ -0,0 +1,81 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <queue>
+#include <vector>
+
+#include "core.h"
+
+namespace Fac {
+    /**
+     * Scheduler
+     * ---------
+     * Runs the updates of a fixed list of entities, always in the same order.
+     * After its update every entity is asked for its sleep time (see GameWorldEntity::getSleepTime).
+     * A sleeping entity is skipped until its wake up time is reached or one of its watched stacks
+     * changes. It then gets the whole elapsed time in a single update, which gives the same result
+     * as updating it every tick.
+     */
+    class Scheduler {
+    public:
+        Scheduler() = default;
+
+        // a copy does not take over the entities, it has to be rebuilt before it is used
+        Scheduler(Scheduler const &) {
+        }
+
+        Scheduler &operator=(Scheduler const &) {
+            clear();
+            return *this;
+        }
+
+        // takes over the update order, all entities start awake
+        void rebuild(std::vector<GameWorldEntity *> const &entities);
+
+        void clear();
+
+        [[nodiscard]] bool needsRebuild() const { return _needs_rebuild; }
+
+        // has to be called when entities were added or removed
+        void invalidate() { _needs_rebuild = true; }
+
+        // advances the time by dt and updates all entities that are awake or whose wake up time was reached
+        void update(double dt);
+
+        // runs the given number of 1 ms ticks. Ticks in which no entity is awake are skipped,
+        // the time jumps directly to the next wake up time
+        void run(long ticks);
+
+        // forces an update of every entity with the next tick, e.g. after changes from outside the simulation
+        void wakeAll();
+
+        // hands the elapsed time to all sleeping entities, so their state is up-to-date when read from outside
+        void sync();
+
+    private:
+        struct Timer {
+            double time;
+            int slot;
+            unsigned generation;
+
+            bool operator>(Timer const &other) const { return time > other.time; }
+        };
+
+        void updateSlot(int slot);
+
+        [[nodiscard]] bool anyAwake() const;
+
+        void sleep(int slot, double sleep_time);
+
+        std::vector<GameWorldEntity *> _entities;
+        std::vector<std::shared_ptr<SleepState> > _states;
+        std::vector<double> _last_update;
+        std::vector<unsigned> _generation;
+        std::shared_ptr<AwakeSlots> _awake = std::make_shared<AwakeSlots>();
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<> > _timers;
+        double _time = 0;
+        bool _needs_rebuild = true;
+    };
+}
+
+#endif //SCHEDULER_H
@@ -2,6 +2,7 @@
 #include "sim.h"
 
 #include <functional>
+#include <ostream>
 using namespace Fac;
 
 void Fac::to_json(json &j, const Machine &r) {
@@ -11,7 +12,7 @@ void Fac::to_json(json &j, const Machine &r) {
         {"name", r.name}, {"inp_slots", r._input_slots}, {"out_slots", r._output_slots},
         {"input", r._input_connections}
     };
-    m["output"] = (OutputStackProvider) r;
+    m["output"] = static_cast<OutputStackProvider const &>(r);
     j["machine"] = m;
 }
 
@@ -21,7 +22,9 @@ void Fac::from_json(const json &j, Machine &r) {
     r._id = j.at("machine").at("id").get<int>();
     r._input_slots = j.at("machine").at("inp_slots").get<int>();
     r._output_slots = j.at("machine").at("out_slots").get<int>();
-    r.setRecipe(j.at("machine").at("recipe").get<Recipe>());
+    // the saved stacks are locked to the resources of the recipe already
+    r._active_recipe = j.at("machine").at("recipe").get<std::optional<Recipe> >();
+    r.prepareRecipe();
     r._input_connections = j.at("machine").at("input").get<std::vector<BufferedConnection> >();
     r._output_stacks = j.at("machine").at("output").at("_output_stacks").get<std::vector<std::shared_ptr<Stack> > >();
     r.name = j.at("machine").at("name").get<std::string>();
@@ -69,7 +72,7 @@ void Fac::to_json(json &j, const Extractor &r) {
         {"id", r.getId()}, {"extractionProgress", r.extraction_progress}, {"extracting", r.extracting},
         {"resNodeId", r._res_node_id}, {"name", r.name}, {"defaultExtractionSpeed", r._default_extraction_speed}
     };
-    m["output"] = (OutputStackProvider) r;
+    m["output"] = static_cast<OutputStackProvider const &>(r);
     j["resourceExtractor"] = m;
 }
 
@@ -90,23 +93,62 @@ void Fac::to_json(json &j, const Belt &r) {
     auto id = r.getId();
     auto m = json{
         {"id", id}, {"itemsPerSecond", r.getItemsPerSecond()}, {"active", r.getActive()}, {"jammed", r.getJammed()},
-        {"name", r.name}
+        {"name", r.name}, {"length", r.getLength()}
     };
-    m["input"] = (InputStackProvider) r;
-    m["output"] = (OutputStackProvider) r;
-    m["inTransitStack"] = r._in_transit_stack;
+    m["input"] = static_cast<InputStackProvider const &>(r);
+    m["output"] = static_cast<OutputStackProvider const &>(r);
+    // times are saved relative to the belt time, the time itself starts again at 0 after loading
+    auto lane = json::array();
+    for (int i = 0; i < r._lane_count; i++) {
+        auto const &item = r._lane[(r._lane_head + i) % r.getLength()];
+        lane.push_back({{"resource", item.resource}, {"age", r._clock - item.entered}});
+    }
+    m["lane"] = lane;
+    m["nextEntry"] = std::max(0.0, r._next_entry - r._clock);
+    m["nextExit"] = std::max(0.0, r._next_exit - r._clock);
     j["itemMover"] = m;
 }
 
 void Fac::from_json(const json &j, Belt &r) {
-    r._items_per_s = j.at("itemMover").at("itemsPerSecond").get<int>();
-    r._active = j.at("itemMover").at("active").get<bool>();
-    r._in_transit_stack = j.at("itemMover").at("inTransitStack").get<std::vector<Resource> >();
-    r._jammed = j.at("itemMover").at("jammed").get<bool>();
-    r._id = j.at("itemMover").at("id").get<int>();
-    r._input_connections = j.at("itemMover").at("input").at("_input_connections").get<std::vector<InputConnection> >();
-    r._output_stacks = j.at("itemMover").at("output").at("_output_stacks").get<std::vector<std::shared_ptr<Stack> > >();
-    r.name = j.at("itemMover").at("name").get<std::string>();
+    auto const &m = j.at("itemMover");
+    r._items_per_s = m.at("itemsPerSecond").get<double>();
+    r._active = m.at("active").get<bool>();
+    r._jammed = m.at("jammed").get<bool>();
+    r._id = m.at("id").get<int>();
+    r._input_connections = m.at("input").at("_input_connections").get<std::vector<InputConnection> >();
+    r._output_stacks = m.at("output").at("_output_stacks").get<std::vector<std::shared_ptr<Stack> > >();
+    r.name = m.at("name").get<std::string>();
+
+    r._clock = 0;
+    auto const length = m.value("length", 1);
+    if (length < 1) {
+        throw std::runtime_error("A belt needs a length of at least 1");
+    }
+    r._lane.assign(length, {});
+    r._lane_head = 0;
+    r._lane_count = 0;
+    if (m.contains("lane")) {
+        if (m.at("lane").size() > static_cast<size_t>(length)) {
+            throw std::runtime_error("More items than room on a belt");
+        }
+        for (auto const &item: m.at("lane")) {
+            r.push(item.at("resource").get<Resource>());
+            r._lane[r._lane_count - 1].entered = -item.at("age").get<double>();
+        }
+        r._next_entry = m.at("nextEntry").get<double>();
+        r._next_exit = m.at("nextExit").get<double>();
+    } else {
+        // saves from before the belts had lanes, their single item starts again at the input
+        auto const items = m.at("inTransitStack").get<std::vector<Resource> >();
+        if (items.size() > static_cast<size_t>(length)) {
+            throw std::runtime_error("More items than room on a belt");
+        }
+        for (auto const resource: items) {
+            r.push(resource);
+        }
+        r._next_entry = 0;
+        r._next_exit = 0;
+    }
 }
 
 void Fac::to_json(json &j, const Merger &r) {
@@ -115,14 +157,14 @@ void Fac::to_json(json &j, const Merger &r) {
         {"id", id}, {"itemsPerSecond", r.getItemsPerSecond()}, {"active", r.getActive()}, {"jammed", r.getJammed()},
         {"name", r.name}
     };
-    m["input"] = (InputStackProvider) r;
-    m["output"] = (OutputStackProvider) r;
+    m["input"] = static_cast<InputStackProvider const &>(r);
+    m["output"] = static_cast<OutputStackProvider const &>(r);
     m["inTransitStack"] = r._in_transit_stack;
     j["itemMover"] = m;
 }
 
 void Fac::from_json(const json &j, Merger &r) {
-    r._items_per_s = j.at("itemMover").at("itemsPerSecond").get<int>();
+    r._items_per_s = j.at("itemMover").at("itemsPerSecond").get<double>();
     r._active = j.at("itemMover").at("active").get<bool>();
     r._in_transit_stack = j.at("itemMover").at("inTransitStack").get<std::vector<Resource> >();
     r._jammed = j.at("itemMover").at("jammed").get<bool>();
@@ -138,14 +180,14 @@ void Fac::to_json(json &j, const Splitter &r) {
         {"id", id}, {"itemsPerSecond", r.getItemsPerSecond()}, {"active", r.getActive()}, {"jammed", r.getJammed()},
         {"name", r.name}
     };
-    m["input"] = (InputStackProvider) r;
-    m["output"] = (OutputStackProvider) r;
+    m["input"] = static_cast<InputStackProvider const &>(r);
+    m["output"] = static_cast<OutputStackProvider const &>(r);
     m["inTransitStack"] = r._in_transit_stack;
     j["itemMover"] = m;
 }
 
 void Fac::from_json(const json &j, Splitter &r) {
-    r._items_per_s = j.at("itemMover").at("itemsPerSecond").get<int>();
+    r._items_per_s = j.at("itemMover").at("itemsPerSecond").get<double>();
     r._active = j.at("itemMover").at("active").get<bool>();
     r._in_transit_stack = j.at("itemMover").at("inTransitStack").get<std::vector<Resource> >();
     r._jammed = j.at("itemMover").at("jammed").get<bool>();
@@ -161,8 +203,8 @@ void Fac::to_json(json &j, const Storage &r) {
     auto m = json{
         {"id", id}, {"max_item_stacks", r._max_item_stacks}, {"name", r.name}
     };
-    m["input"] = (InputStackProvider) r;
-    m["output"] = (OutputStackProvider) r;
+    m["input"] = static_cast<InputStackProvider const &>(r);
+    m["output"] = static_cast<OutputStackProvider const &>(r);
     m["content"] = r._content_stacks;
     j["storage"] = m;
 }
@@ -173,117 +215,93 @@ void Fac::from_json(const json &j, Storage &r) {
     r._output_stacks = j.at("storage").at("output").at("_output_stacks").get<std::vector<std::shared_ptr<Stack> > >();
     r._max_item_stacks = j.at("storage").at("max_item_stacks").get<int>();
     r._content_stacks = j.at("storage").at("content").get<std::vector<Stack> >();
+    r.reindex();
     r.name = j.at("storage").at("name").get<std::string>();
 }
 
 
+// the type tag an entity is stored with in a save
+template<typename T>
+static constexpr std::string_view entityTypeName() {
+    if constexpr (std::is_same_v<T, Belt>) {
+        return "Belt";
+    } else if constexpr (std::is_same_v<T, Stack>) {
+        return "Stack";
+    } else if constexpr (std::is_same_v<T, Machine>) {
+        return "Machine";
+    } else if constexpr (std::is_same_v<T, ResourceNode>) {
+        return "ResourceNode";
+    } else if constexpr (std::is_same_v<T, Merger>) {
+        return "Merger";
+    } else if constexpr (std::is_same_v<T, Splitter>) {
+        return "Splitter";
+    } else if constexpr (std::is_same_v<T, Extractor>) {
+        return "ResourceExtractor";
+    } else if constexpr (std::is_same_v<T, Storage>) {
+        return "Storage";
+    } else {
+        static_assert(sizeof(T) == 0, "Unsupported entity type");
+    }
+}
+
 void Fac::to_json(json &j, const Factory &r) {
     j["id"] = r.getId();
     j["entities"] = json::array();
 
-    // Loop through each entity in the vector
-    for (const auto &entity: r._entities) {
-        json entity_json;
-
-        std::visit([&entity_json](const auto &e) {
-            if (std::is_same_v<std::decay_t<decltype(*e)>, Belt>) {
-                entity_json["type"] = "Belt";
-                entity_json["data"] = *std::dynamic_pointer_cast<Belt>(e);
-            } else if (std::is_same_v<std::decay_t<decltype(*e)>, Stack>) {
-                entity_json["type"] = "Stack";
-                entity_json["data"] = *std::dynamic_pointer_cast<Stack>(e);
-            } else if (std::is_same_v<std::decay_t<decltype(*e)>, Machine>) {
-                entity_json["type"] = "Machine";
-                entity_json["data"] = *std::dynamic_pointer_cast<Machine>(e);
-            } else if (std::is_same_v<std::decay_t<decltype(*e)>, ResourceNode>) {
-                entity_json["type"] = "ResourceNode";
-                entity_json["data"] = *std::dynamic_pointer_cast<ResourceNode>(e);
-            } else if (std::is_same_v<std::decay_t<decltype(*e)>, Merger>) {
-                entity_json["type"] = "Merger";
-                entity_json["data"] = *std::dynamic_pointer_cast<Merger>(e);
-            } else if (std::is_same_v<std::decay_t<decltype(*e)>, Splitter>) {
-                entity_json["type"] = "Splitter";
-                entity_json["data"] = *std::dynamic_pointer_cast<Splitter>(e);
-            } else if (std::is_same_v<std::decay_t<decltype(*e)>, Extractor>) {
-                entity_json["type"] = "ResourceExtractor";
-                entity_json["data"] = *std::dynamic_pointer_cast<Extractor>(e);
-            } else if (std::is_same_v<std::decay_t<decltype(*e)>, Storage>) {
-                entity_json["type"] = "Storage";
-                entity_json["data"] = *std::dynamic_pointer_cast<Storage>(e);
-            } else {
-                throw std::runtime_error("Unsupported entity type");
-            }
-        }, entity);
+    // Loop through each entity array, the type of all entities in an array is known up front
+    r._entities.forEachArray([&j]<typename T>(std::vector<std::shared_ptr<T> > const &array) {
+        for (const auto &entity: array) {
+            json entity_json;
+            entity_json["type"] = entityTypeName<T>();
+            entity_json["data"] = *entity;
+            j["entities"].push_back(entity_json);
+        }
+    });
+}
 
-        j["entities"].push_back(entity_json);
-    }
+void Fac::writeJson(std::ostream &out, const Factory &r) {
+    // the keys in the order of to_json, which sorts them
+    out << R"({"entities":[)";
+    auto first = true;
+    r._entities.forEachArray([&]<typename T>(std::vector<std::shared_ptr<T> > const &array) {
+        for (const auto &entity: array) {
+            out << (first ? "" : ",") << R"({"data":)" << json(*entity) << R"(,"type":)" << json(entityTypeName<T>())
+                    << "}";
+            first = false;
+        }
+    });
+    out << R"(],"id":)" << r.getId() << "}";
 }
 
 void Fac::from_json(const json &j, Factory &r) {
-    r._entities.clear();
-    r._entity_map.clear();
+    r.clearWorld();
     r.id = j.at("id").get<int>();
 
     // Loop through each entity in the JSON array
     for (const auto &entity_json: j["entities"]) {
         std::string type = entity_json["type"];
 
-        // Create appropriate variant based on type
-        if (type == "Belt") {
-            auto b = entity_json["data"].get<Belt>();
-            auto belt = std::make_shared<Belt>(b);
-            r._entities.push_back(belt);
-            r._entity_map[belt->getId()] = belt;
-        } else if (type == "Stack") {
-            auto s = entity_json["data"].get<Stack>();
-            auto stack = std::make_shared<Stack>(s);
-            r._entities.push_back(stack);
-            r._entity_map[stack->getId()] = stack;
-        } else if (type == "Machine") {
-            auto m = entity_json["data"].get<Machine>();
-            auto machine = std::make_shared<Machine>(m);
-            r._entities.push_back(machine);
-            r._entity_map[machine->getId()] = machine;
-        } else if (type == "ResourceNode") {
-            auto m = entity_json["data"].get<ResourceNode>();
-            auto node = std::make_shared<ResourceNode>(m);
-            r._entities.push_back(node);
-            r._entity_map[node->getId()] = node;
-        } else if (type == "ResourceExtractor") {
-            auto m = entity_json["data"].get<Extractor>();
-            auto extractor = std::make_shared<Extractor>(m);
-            r._entities.push_back(extractor);
-            r._entity_map[extractor->getId()] = extractor;
-        } else if (type == "Merger") {
-            auto m = entity_json["data"].get<Merger>();
-            auto merger = std::make_shared<Merger>(m);
-            r._entities.push_back(merger);
-            r._entity_map[merger->getId()] = merger;
-        } else if (type == "Splitter") {
-            auto m = entity_json["data"].get<Splitter>();
-            auto splitter = std::make_shared<Splitter>(m);
-            r._entities.push_back(splitter);
-            r._entity_map[splitter->getId()] = splitter;
-        } else if (type == "Storage") {
-            auto m = entity_json["data"].get<Storage>();
-            auto storage = std::make_shared<Storage>(m);
-            r._entities.push_back(storage);
-            r._entity_map[storage->getId()] = storage;
+        // Create appropriate entity based on type
+        if (type == entityTypeName<Belt>()) {
+            r.addEntity(std::make_shared<Belt>(entity_json["data"].get<Belt>()));
+        } else if (type == entityTypeName<Stack>()) {
+            r.addEntity(std::make_shared<Stack>(entity_json["data"].get<Stack>()));
+        } else if (type == entityTypeName<Machine>()) {
+            r.addEntity(std::make_shared<Machine>(entity_json["data"].get<Machine>()));
+        } else if (type == entityTypeName<ResourceNode>()) {
+            r.addEntity(std::make_shared<ResourceNode>(entity_json["data"].get<ResourceNode>()));
+        } else if (type == entityTypeName<Extractor>()) {
+            r.addEntity(std::make_shared<Extractor>(entity_json["data"].get<Extractor>()));
+        } else if (type == entityTypeName<Merger>()) {
+            r.addEntity(std::make_shared<Merger>(entity_json["data"].get<Merger>()));
+        } else if (type == entityTypeName<Splitter>()) {
+            r.addEntity(std::make_shared<Splitter>(entity_json["data"].get<Splitter>()));
+        } else if (type == entityTypeName<Storage>()) {
+            r.addEntity(std::make_shared<Storage>(entity_json["data"].get<Storage>()));
         } else {
             throw std::runtime_error("Unknown entity type in JSON");
         }
     }
 
-    auto fn = [r](const int id) -> std::optional<std::shared_ptr<GameWorldEntity> > {
-        return r.getEntityById(id);
-    };
-
-    // iterate over the entities and reconnect the links
-    for (const auto &entity: r._entities) {
-        std::visit([&r, fn](const auto &e) {
-            if (auto link = std::dynamic_pointer_cast<IInputLink>(e)) {
-                link->reconnectLinks(fn);
-            }
-        }, entity);
-    }
+    r.reconnectLinks();
 }
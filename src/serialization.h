@@ -2,6 +2,7 @@
 #define SERIALIZATION_H
 
 #include <nlohmann/json.hpp>
+#include "tools/fixed_vector.h"
 
 using json = nlohmann::json;
 
@@ -17,6 +18,13 @@ namespace Fac {
     class Splitter;
     class Merger;
     class Machine;
+    class Storage;
+    class Factory;
+    class BufferedConnection;
+    class BinaryWriter;
+    class BinaryReader;
+
+    struct BinaryEntityRange;
 }
 
 // For custom types like std::optional
@@ -58,6 +66,24 @@ namespace nlohmann {
             }
         }
     };
+
+    // saved like a std::vector
+    template<typename T, std::size_t N>
+    struct adl_serializer<FixedVector<T, N> > {
+        static void to_json(json &j, const FixedVector<T, N> &values) {
+            j = json::array();
+            for (const auto &value: values) {
+                j.push_back(value);
+            }
+        }
+
+        static void from_json(const json &j, FixedVector<T, N> &values) {
+            values.clear();
+            for (const auto &value: j) {
+                values.push_back(value.get<T>());
+            }
+        }
+    };
 }
 
 namespace Fac {
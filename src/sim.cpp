@@ -1,21 +1,134 @@
 #include "sim.h"
 #include <chrono>
 #include <iostream>
+#include <numeric>
+#include <unordered_map>
 
 using namespace Fac;
 
-void Factory::update(double const dt) const {
-    for (const auto& variant : _entities) {
-        std::visit([dt](const auto& e) {
-            e->update(dt);
-        }, variant);
+// calls fn(source id) for every entity the given entity takes items from
+template<typename T, typename F>
+static void forEachSource(T const &entity, F &&fn) {
+    if constexpr (std::is_same_v<T, Machine>) {
+        for (int i = 0; i < entity.getInputSlots(); i++) {
+            fn(entity.getInputConnection(i).sourceId);
+        }
+    } else if constexpr (std::is_same_v<T, Merger>) {
+        fn(entity.getInputConnection(0).sourceId);
+        fn(entity.getInputConnection(1).sourceId);
+    } else if constexpr (std::is_same_v<T, Storage> || std::is_same_v<T, Belt> || std::is_same_v<T, Splitter>) {
+        fn(entity.getInputConnection(0).sourceId);
+    }
+}
+
+void Factory::prepareSchedule() const {
+    if (!_schedulers.empty() && !_schedulers.front().needsRebuild() &&
+        _schedule_link_generation == *_link_generation) {
+        return;
+    }
+    _schedule_link_generation = *_link_generation;
+
+    // the update order is the order of the entity arrays
+    std::vector<GameWorldEntity *> entities;
+    std::unordered_map<int, int> index;
+    entities.reserve(_entities.size());
+    _entities.forEachArray([&]<typename T>(std::vector<std::shared_ptr<T> > const &array) {
+        // stacks and resource nodes are passive, there is nothing to update
+        if constexpr (!std::is_same_v<T, Stack> && !std::is_same_v<T, ResourceNode>) {
+            for (auto const &e: array) {
+                index[e->getId()] = static_cast<int>(entities.size());
+                entities.push_back(e.get());
+            }
+        }
+    });
+
+    // entities linked by an input connection share a stack and end up in the same group
+    std::vector<int> parent(entities.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto const root = [&parent](int e) {
+        while (parent[e] != e) {
+            e = parent[e] = parent[parent[e]];
+        }
+        return e;
+    };
+    _entities.forEachArray([&]<typename T>(std::vector<std::shared_ptr<T> > const &array) {
+        for (auto const &e: array) {
+            forEachSource(*e, [&](int const source_id) {
+                if (auto const source = index.find(source_id); source_id != 0 && source != index.end()) {
+                    parent[root(index.at(e->getId()))] = root(source->second);
+                }
+            });
+        }
+    });
+
+    std::map<int, std::vector<int> > components;
+    for (int e = 0; e < entities.size(); e++) {
+        components[root(e)].push_back(e);
+    }
+
+    // the biggest components first, each one goes to the group with the fewest entities
+    std::vector<std::vector<int> const *> by_size;
+    for (auto const &members: components | std::views::values) {
+        by_size.push_back(&members);
+    }
+    std::ranges::stable_sort(by_size, std::greater{}, [](auto const *members) { return members->size(); });
+
+    auto const threads = _pool != nullptr ? _pool->size() : 1;
+    auto const groups = std::max<size_t>(1, std::min(threads, by_size.size()));
+    std::vector<std::vector<int> > group_members(groups);
+    for (auto const *members: by_size) {
+        auto &smallest = *std::ranges::min_element(group_members, {}, &std::vector<int>::size);
+        smallest.insert(smallest.end(), members->begin(), members->end());
     }
+
+    _schedulers.clear();
+    _schedulers.resize(groups);
+    for (int g = 0; g < groups; g++) {
+        std::ranges::sort(group_members[g]);
+        std::vector<GameWorldEntity *> group_entities;
+        group_entities.reserve(group_members[g].size());
+        for (auto const e: group_members[g]) {
+            group_entities.push_back(entities[e]);
+        }
+        _schedulers[g].rebuild(group_entities);
+    }
+}
+
+void Factory::forEachScheduler(std::function<void(Scheduler &)> const &fn) const {
+    if (_pool != nullptr && _schedulers.size() > 1) {
+        _pool->forEach(_schedulers.size(), [&](size_t const i) { fn(_schedulers[i]); });
+    } else {
+        for (auto &scheduler: _schedulers) {
+            fn(scheduler);
+        }
+    }
+}
+
+void Factory::update(double const dt) const {
+    prepareSchedule();
+    forEachScheduler([dt](Scheduler &scheduler) {
+        // callers read any entity after an update, the sleeping ones would be behind
+        scheduler.wakeAll();
+        scheduler.update(dt);
+    });
 }
 
-// Updates the Factory by 1 ms at a time, until the given time has passed, then calls the callback
+void Factory::step(long const ticks) const {
+    prepareSchedule();
+    forEachScheduler([ticks](Scheduler &scheduler) {
+        // the entities might have been changed from outside since the last step
+        scheduler.wakeAll();
+        scheduler.run(ticks);
+        scheduler.sync();
+    });
+}
+
+// Advances the Factory in 1 ms steps until the given time has passed, then calls the callback.
+// Steps in which every entity sleeps are skipped, so catching up on offline time only costs
+// the events that happened in it.
 void Factory::advanceBy(double const dt, std::function<void()> const &callback) const {
-    for (auto i = 0; i <= dt; i++) {
-        update(1);
+    if (dt >= 0) {
+        step(static_cast<long>(dt) + 1);
     }
     callback();
 }
@@ -24,27 +137,96 @@ void Factory::processWorldStep() const {
     using Clock = std::chrono::steady_clock;
     using TimePoint = std::chrono::time_point<Clock>;
 
-    static TimePoint previousTime = Clock::now();
-
+    // every factory keeps its own time, factories are stepped independently (and in parallel)
     TimePoint const currentTime = Clock::now();
-    std::chrono::duration<double> const elapsed = currentTime - previousTime;
+    std::chrono::duration<double> const elapsed = currentTime - _previous_step_time.value_or(currentTime);
     const double deltaTime = elapsed.count() * 1000;
 
     update(deltaTime);
-    previousTime = currentTime;
+    _previous_step_time = currentTime;
 
     // Notify observers
-    for (const auto &entity: _entities) {
-        std::visit([this](const auto &e) {
-            if (auto gameEntity = std::dynamic_pointer_cast<GameWorldEntity>(e)) {
-                auto const id = gameEntity->getId();
-                auto observer = std::find_if(_observers.begin(), _observers.end(), [id](const EntityObserver &observer) {
-                    return observer.id == id;
-                });
-                if (observer != _observers.end()) {
-                    observer->callback(gameEntity);
-                }
+    for (const auto &observer: _observers) {
+        if (auto const entity = _entity_map.find(observer.id); entity != _entity_map.end()) {
+            observer.callback(entity->second);
+        }
+    }
+}
+
+ResourceArray<long> Factory::getProductionTotals() const {
+    auto totals = _credited_production;
+    for (auto const &m: _entities.get<Machine>()) {
+        totals += m->getProducedAmounts();
+    }
+    for (auto const &e: _entities.get<Extractor>()) {
+        if (e->getExtractedAmount() > 0) {
+            totals[e->getResourceNode()->getResource()] += e->getExtractedAmount();
+        }
+    }
+    return totals;
+}
+
+EntityIndex::EntityIndex(GameWorldEntities const &entities) {
+    auto const count = entities.size();
+    if (count == 0) {
+        return;
+    }
+    auto first = std::numeric_limits<int>::max();
+    auto last = std::numeric_limits<int>::min();
+    entities.forEachArray([&](auto const &array) {
+        for (auto const &e: array) {
+            first = std::min(first, e->getId());
+            last = std::max(last, e->getId());
+        }
+    });
+
+    // a flat array as long as at most half of it stays empty
+    if (auto const range = static_cast<size_t>(static_cast<long>(last) - first) + 1; range <= 2 * count) {
+        _first_id = first;
+        _by_offset.resize(range);
+        entities.forEachArray([&](auto const &array) {
+            for (auto const &e: array) {
+                _by_offset[e->getId() - first] = e;
             }
-        }, entity);
+        });
+        return;
+    }
+
+    _by_id.reserve(count);
+    entities.forEachArray([&](auto const &array) {
+        for (auto const &e: array) {
+            _by_id.emplace_back(e->getId(), e);
+        }
+    });
+    std::ranges::sort(_by_id, {}, &std::pair<int, std::shared_ptr<GameWorldEntity> >::first);
+}
+
+std::shared_ptr<GameWorldEntity> const &EntityIndex::find(int const id) const {
+    static std::shared_ptr<GameWorldEntity> const none;
+    if (!_by_offset.empty()) {
+        auto const offset = static_cast<long>(id) - _first_id;
+        return offset >= 0 && offset < _by_offset.size() ? _by_offset[offset] : none;
     }
+    auto const entry = std::ranges::lower_bound(_by_id, id, {}, &std::pair<int, std::shared_ptr<GameWorldEntity> >::first);
+    return entry != _by_id.end() && entry->first == id ? entry->second : none;
+}
+
+void Factory::reconnectLinks() {
+    auto const index = EntityIndex(_entities);
+    // created once, every link of every entity looks up its source through it
+    std::function<std::optional<std::shared_ptr<GameWorldEntity> >(int)> const getEntityById =
+            [&index](int const id) -> std::optional<std::shared_ptr<GameWorldEntity> > {
+        if (auto const &entity = index.find(id)) {
+            return entity;
+        }
+        return std::nullopt;
+    };
+
+    _entities.forEachArray([&getEntityById]<typename T>(std::vector<std::shared_ptr<T> > const &array) {
+        if constexpr (std::derived_from<T, IInputLink>) {
+            for (auto const &e: array) {
+                e->reconnectLinks(getEntityById);
+            }
+        }
+    });
 }
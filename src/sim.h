@@ -1,25 +1,96 @@
 #ifndef SIM_H
 #define SIM_H
 
+#include <chrono>
 #include <functional>
+#include <iosfwd>
+#include <tuple>
 #include <typeindex>
 
 #include "core.h"
+#include "scheduler.h"
 #include "storage.h"
+#include "tools/thread_pool.h"
 
 namespace Fac {
-    using EntityVariant = std::variant<
-        std::shared_ptr<Stack>,
-        std::shared_ptr<Machine>,
-        std::shared_ptr<Belt>,
-        std::shared_ptr<Merger>,
-        std::shared_ptr<Splitter>,
-        std::shared_ptr<ResourceNode>,
-        std::shared_ptr<Extractor>,
-        std::shared_ptr<Storage>
+    // Per type entity storage. Every entity type has its own array of shared_ptrs, so code that
+    // walks the entities of a type knows the type at compile time, without a variant dispatch or a
+    // cast per entity. The entities themselves are still separate allocations behind the pointers,
+    // the scheduler updates them through GameWorldEntity.
+    template<typename... Ts>
+    class EntityArrays {
+    public:
+        template<typename T>
+        static constexpr bool holds = (std::is_same_v<T, Ts> || ...);
+
+        template<typename T>
+            requires holds<T>
+        [[nodiscard]] std::vector<std::shared_ptr<T> > &get() {
+            return std::get<std::vector<std::shared_ptr<T> > >(_arrays);
+        }
+
+        template<typename T>
+            requires holds<T>
+        [[nodiscard]] std::vector<std::shared_ptr<T> > const &get() const {
+            return std::get<std::vector<std::shared_ptr<T> > >(_arrays);
+        }
+
+        // calls fn(array) once for every entity type, in the order of the template arguments
+        template<typename F>
+        void forEachArray(F &&fn) {
+            std::apply([&](auto &... arrays) { (fn(arrays), ...); }, _arrays);
+        }
+
+        template<typename F>
+        void forEachArray(F &&fn) const {
+            std::apply([&](auto const &... arrays) { (fn(arrays), ...); }, _arrays);
+        }
+
+        void clear() {
+            forEachArray([](auto &array) { array.clear(); });
+        }
+
+        [[nodiscard]] size_t size() const {
+            size_t result = 0;
+            forEachArray([&](auto const &array) { result += array.size(); });
+            return result;
+        }
+
+    private:
+        std::tuple<std::vector<std::shared_ptr<Ts> >...> _arrays;
+    };
+
+    // The order of the types is the order in which Factory::update processes them. Entities update
+    // by type and not in the order they were added, so an item that passes several entities in one
+    // tick can arrive a tick earlier or later than it did with the insertion order
+    using GameWorldEntities = EntityArrays<
+        Stack,
+        ResourceNode,
+        Extractor,
+        Storage,
+        Machine,
+        Belt,
+        Splitter,
+        Merger
     >;
 
-    using GameWorldEntities = std::vector<EntityVariant>;
+    // Finds the entities of a factory by id while it is loaded. Ids are handed out in order, so they
+    // usually form one dense range and are found at their offset in a flat array. Ids that are spread
+    // too far apart are found by a binary search instead.
+    class EntityIndex {
+    public:
+        explicit EntityIndex(GameWorldEntities const &entities);
+
+        // nullptr for an unknown id
+        [[nodiscard]] std::shared_ptr<GameWorldEntity> const &find(int id) const;
+
+    private:
+        int _first_id = 0;
+        // the entity of every id from _first_id on, if the ids are dense
+        std::vector<std::shared_ptr<GameWorldEntity> > _by_offset;
+        // sorted by id, if the ids are sparse
+        std::vector<std::pair<int, std::shared_ptr<GameWorldEntity> > > _by_id;
+    };
 
     struct EntityObserver {
         int id;
@@ -33,12 +104,20 @@ namespace Fac {
 
         friend void from_json(const json &, Factory &);
 
+        friend void writeJson(std::ostream &, const Factory &);
+
+        friend void to_binary(BinaryWriter &, const Factory &);
+
+        friend void from_binary(BinaryReader &, Factory &);
+
+        friend std::vector<BinaryEntityRange> writeFactory(BinaryWriter &, const Factory &);
+
     public:
         Factory() = default;
 
         [[nodiscard]] std::vector<std::shared_ptr<GameWorldEntity> > getEntities() const {
             std::vector<std::shared_ptr<GameWorldEntity> > result;
-            result.reserve(_entities.size());
+            result.reserve(_entity_map.size());
             for (const auto &val: _entity_map | std::views::values) {
                 result.push_back(val);
             }
@@ -50,7 +129,6 @@ namespace Fac {
             return _entity_map.contains(id) ? std::make_optional(_entity_map.at(id)) : std::nullopt;
         }
 
-        // TODO optimization: cache the entities by type
         [[nodiscard]] std::vector<std::shared_ptr<GameWorldEntity> > getEntitiesByType(
             std::type_index const &type) const {
             std::vector<std::shared_ptr<GameWorldEntity> > result;
@@ -66,13 +144,24 @@ namespace Fac {
         template <typename T>
         requires std::derived_from<T, GameWorldEntity>
         [[nodiscard]] std::vector<std::shared_ptr<T> > getEntitiesByType() const {
-            auto gameWorlddEntities = getEntitiesByType(typeid(T));
-            std::vector<std::shared_ptr<T> > result;
-            result.reserve(gameWorlddEntities.size());
-            for (const auto &entity: gameWorlddEntities) {
-                result.push_back(std::dynamic_pointer_cast<T>(entity));
+            if constexpr (GameWorldEntities::holds<T>) {
+                return _entities.get<T>();
+            } else {
+                auto gameWorlddEntities = getEntitiesByType(typeid(T));
+                std::vector<std::shared_ptr<T> > result;
+                result.reserve(gameWorlddEntities.size());
+                for (const auto &entity: gameWorlddEntities) {
+                    result.push_back(std::dynamic_pointer_cast<T>(entity));
+                }
+                return result;
             }
-            return result;
+        }
+
+        // the entities of one stored type, in update order
+        template<typename T>
+            requires GameWorldEntities::holds<T>
+        [[nodiscard]] std::vector<std::shared_ptr<T> > const &getEntityArray() const {
+            return _entities.get<T>();
         }
 
         // templates need to be available at compile time, not just at link time, so
@@ -80,39 +169,94 @@ namespace Fac {
         template<typename T>
             requires std::derived_from<T, GameWorldEntity>
         void addEntity(std::shared_ptr<T> const &entity) {
+            if constexpr (GameWorldEntities::holds<T>) {
+                _entities.get<T>().push_back(entity);
+                if constexpr (std::derived_from<T, IInputLink>) {
+                    entity->setLinkGeneration(_link_generation);
+                }
+            } else {
+                // only the base type is known, find the array of the concrete type
+                auto added = false;
+                _entities.forEachArray([&]<typename U>(std::vector<std::shared_ptr<U> > &array) {
+                    if (auto const e = std::dynamic_pointer_cast<U>(entity); e && !added) {
+                        array.push_back(e);
+                        if constexpr (std::derived_from<U, IInputLink>) {
+                            e->setLinkGeneration(_link_generation);
+                        }
+                        added = true;
+                    }
+                });
+                if (!added) {
+                    throw std::runtime_error("Unsupported entity type");
+                }
+            }
             _entity_map[entity->getId()] = entity;
-            _entities.push_back(entity);
+            invalidateSchedule();
         }
 
         template<typename T>
             requires std::derived_from<T, GameWorldEntity>
         bool removeEntity(std::shared_ptr<T> const &entity) {
-            if (_entities.empty()) {
+            if (_entity_map.empty()) {
                 return false;
             }
 
-            _entities.erase(std::remove_if(_entities.begin(), _entities.end(), [&entity](auto const &e) {
-                const std::shared_ptr<GameWorldEntity> basePtr = std::visit(
-                    [](const auto &ptr) -> std::shared_ptr<GameWorldEntity> {
-                        return ptr; // Implicit upcast to base class pointer
-                    }, e);
-                return basePtr->getId() == entity->getId();
-            }), _entities.end());
+            auto const id = entity->getId();
+            _entities.forEachArray([id]<typename U>(std::vector<std::shared_ptr<U> > &array) {
+                std::erase_if(array, [id](auto const &e) {
+                    if (e->getId() != id) {
+                        return false;
+                    }
+                    // new links of the removed entity are no longer part of this factory
+                    if constexpr (std::derived_from<U, IInputLink>) {
+                        e->setLinkGeneration(nullptr);
+                    }
+                    return true;
+                });
+            });
 
-            _entity_map.erase(entity->getId());
+            _entity_map.erase(id);
+            // inputs linked to the removed entity look up their stacks again
+            ++*_link_generation;
+            invalidateSchedule();
 
             return true;
         }
 
         void clearWorld() {
+            _entities.forEachArray([]<typename U>(std::vector<std::shared_ptr<U> > const &array) {
+                if constexpr (std::derived_from<U, IInputLink>) {
+                    for (auto const &e: array) {
+                        e->setLinkGeneration(nullptr);
+                    }
+                }
+            });
             _entities.clear();
             _entity_map.clear();
+            invalidateSchedule();
+        }
+
+        // Entities that are not connected to each other are updated on the threads of the pool, the
+        // result is the same as updating them one after another. Without a pool everything runs on the
+        // calling thread.
+        void setThreadPool(std::shared_ptr<ThreadPool> const &pool) {
+            _pool = pool;
+            invalidateSchedule();
         }
 
+        [[nodiscard]] std::shared_ptr<ThreadPool> const &getThreadPool() const { return _pool; }
+
+        // updates every entity by dt, sleeping ones included, so every entity is up-to-date when read
+        // afterwards. Nothing is skipped here, only step skips entities and ticks without work
         void update(double dt) const;
 
+        // runs the given number of 1 ms updates, entities without work and ticks without any work are skipped
+        void step(long ticks) const;
+
         void advanceBy(double dt, std::function<void()> const &callback) const;
 
+        // updates by the real time since the last call and notifies the observers. Factories share no
+        // entities, so different factories may be stepped on different threads at the same time
         void processWorldStep() const;
 
         void registerObserver(int const id, std::function<void(std::shared_ptr<GameWorldEntity>)> const &callback) {
@@ -121,9 +265,40 @@ namespace Fac {
 
         int getId() const { return id; }
 
+        // items produced by all machines and extractors since they were created or loaded, per resource,
+        // including the credited production
+        [[nodiscard]] ResourceArray<long> getProductionTotals() const;
+
+        // adds production that was estimated instead of simulated, e.g. while the factory was stored
+        void creditProduction(ResourceArray<long> const &production) {
+            _credited_production += production;
+        }
+
+        // links the entities of a loaded factory by their ids, in one pass over an EntityIndex
+        void reconnectLinks();
+
     private:
+        void prepareSchedule() const;
+
+        void invalidateSchedule() {
+            for (auto &scheduler: _schedulers) {
+                scheduler.invalidate();
+            }
+        }
+
+        void forEachScheduler(std::function<void(Scheduler &)> const &fn) const;
+
         int id = generate_id();
         GameWorldEntities _entities;
+        // one scheduler per group of connected entities, groups never share a stack
+        mutable std::vector<Scheduler> _schedulers;
+        // counted up by every new link between the entities of this factory and every removal, shared with them
+        std::shared_ptr<std::atomic<unsigned> > _link_generation = std::make_shared<std::atomic<unsigned> >(0);
+        // the _link_generation the schedule was built for
+        mutable unsigned _schedule_link_generation = 0;
+        std::shared_ptr<ThreadPool> _pool;
+        mutable std::optional<std::chrono::steady_clock::time_point> _previous_step_time;
+        ResourceArray<long> _credited_production;
         std::vector<EntityObserver> _observers;
         std::map<int, std::shared_ptr<GameWorldEntity> > _entity_map;
     };
@@ -131,5 +306,9 @@ namespace Fac {
     void to_json(json &j, const Factory &r);
 
     void from_json(const json &j, Factory &r);
+
+    // writes the same JSON as to_json to the stream, without a document of the whole factory.
+    // Only the document of one entity exists at a time
+    void writeJson(std::ostream &out, const Factory &r);
 }
 #endif //SIM_H
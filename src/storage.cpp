@@ -3,43 +3,128 @@
 using namespace Fac;
 
 void Storage::update(double dt) {
+    if (auto &input = inputStack(0); !input.isEmpty()) {
+        store(input);
+    }
+
+    // feed any output connections
+    for (int i = 0; i < _output_stacks.size(); i++) {
+        if (auto &output_stack = outputStack(i); !output_stack.isFull()) {
+            feed(output_stack);
+        }
+    }
+}
+
+double Storage::getSleepTime() const {
+    // is there an item at the input that could be stored?
+    if (auto const &input = inputStack(0); !input.isEmpty() && getRoom(input.getResource()) > 0) {
+        return 0;
+    }
 
-    if (!getInputStack(0)->isEmpty()) {
-        auto const resource = getInputStack(0)->getResource();
-
-        // find a stack that can take the item
-        auto const stack = std::ranges::find_if(_content_stacks, [&](Stack &s) {
-            return s.canAdd(1, resource);
-        });
-
-        if (stack != _content_stacks.end()) {
-            stack->addOne(resource);
-            getInputStack(0)->removeOne();
-        } else {
-            // can we add a new stack for the item?
-            if (_content_stacks.size() < _max_item_stacks) {
-                auto new_stack = Stack();
-                new_stack.addOne(resource);
-                _content_stacks.push_back(new_stack);
-                getInputStack(0)->removeOne();
+    // can any output connection be fed?
+    for (auto const &output_stack: _output_stacks) {
+        if (output_stack->isFull()) {
+            continue;
+        }
+        if (output_stack->isEmpty() ? _empty_stacks.size() < _content_stacks.size()
+                                    : _stacks_by_resource[output_stack->getResource()].amount > 0) {
+            return 0;
+        }
+    }
+    return SLEEP_FOREVER;
+}
+
+void Storage::watchStacks(std::shared_ptr<SleepState> const &state) const {
+    inputStack(0).addSleeper(state);
+    for (auto const &output_stack: _output_stacks) {
+        output_stack->addSleeper(state);
+    }
+}
+
+int Storage::getRoom(Resource const &r) const {
+    auto const new_stacks = std::max(0, _max_item_stacks - static_cast<int>(_content_stacks.size()));
+    auto room = static_cast<int>(_empty_stacks.size() + new_stacks) * MAX_STACK_SIZE;
+    if (auto const &stacks = _stacks_by_resource[r].stacks; !stacks.empty()) {
+        room += _content_stacks[stacks.back()].getRoom(r);
+    }
+    return room;
+}
+
+int Storage::storeAmount(int const amount, Resource const &r) {
+    auto const stored = std::min(amount, getRoom(r));
+    auto items = Stack();
+    for (auto left = stored; left > 0; left -= MAX_STACK_SIZE) {
+        items.addAmount(std::min(left, MAX_STACK_SIZE), r);
+        store(items);
+    }
+    return stored;
+}
+
+std::optional<size_t> Storage::takeEmptyStack() {
+    if (!_empty_stacks.empty()) {
+        auto const index = _empty_stacks.back();
+        _empty_stacks.pop_back();
+        return index;
+    }
+    if (_content_stacks.size() < _max_item_stacks) {
+        _content_stacks.emplace_back();
+        return _content_stacks.size() - 1;
+    }
+    return std::nullopt;
+}
+
+void Storage::store(Stack &input) {
+    auto const resource = input.getResource();
+    auto &[amount, stacks] = _stacks_by_resource[resource];
+    while (!input.isEmpty()) {
+        if (stacks.empty() || _content_stacks[stacks.back()].isFull()) {
+            auto const empty_stack = takeEmptyStack();
+            if (!empty_stack.has_value()) {
+                break;
             }
+            stacks.push_back(*empty_stack);
         }
+        amount += input.transferTo(_content_stacks[stacks.back()]);
     }
+}
 
-    // feed any output connections
-    if (_content_stacks.empty()) {
+void Storage::feed(Stack &output) {
+    // an empty output takes the first resource there is
+    auto const entry = output.isEmpty()
+                           ? std::ranges::find_if(_stacks_by_resource, [](auto const &s) { return s.amount > 0; })
+                           : _stacks_by_resource.begin() + static_cast<std::size_t>(output.getResource());
+    if (entry == _stacks_by_resource.end()) {
         return;
     }
+    auto &[amount, stacks] = *entry;
+    while (!output.isFull() && !stacks.empty()) {
+        auto &stack = _content_stacks[stacks.back()];
+        amount -= stack.transferTo(output);
+        if (stack.isEmpty()) {
+            _empty_stacks.push_back(stacks.back());
+            stacks.pop_back();
+        }
+    }
+}
 
-    for (int i = 0; i < _output_stacks.size(); i++) {
-        if (auto const output_stack = getOutputStack(i); !output_stack->isFull()) {
-            for (auto &contentStack: _content_stacks) {
-                if ((contentStack.getResource() == output_stack->getResource() || output_stack->isEmpty())  && contentStack.getAmount() > 0) {
-                    output_stack->addOne(contentStack.getResource());
-                    contentStack.removeOne();
-                    break;
-                }
+void Storage::reindex() {
+    _stacks_by_resource = {};
+    _empty_stacks.clear();
+    for (size_t i = 0; i < _content_stacks.size(); i++) {
+        auto &stack = _content_stacks[i];
+        if (!stack.isEmpty()) {
+            // older saves can have several stacks with room left, top up the last one first
+            auto &[amount, stacks] = _stacks_by_resource[stack.getResource()];
+            amount += stack.getAmount();
+            if (!stacks.empty()) {
+                stack.transferTo(_content_stacks[stacks.back()]);
             }
+            if (!stack.isEmpty()) {
+                stacks.push_back(i);
+            }
+        }
+        if (stack.isEmpty()) {
+            _empty_stacks.push_back(i);
         }
     }
 }
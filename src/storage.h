@@ -9,6 +9,10 @@ namespace Fac {
 
         friend void from_json(const json &j, Storage &r);
 
+        friend void to_binary(BinaryWriter &w, const Storage &r);
+
+        friend void from_binary(BinaryReader &b, Storage &r);
+
     public:
         constexpr static int OUTPUT_STACK_SIZE = 5;
         explicit Storage(): InputStackProvider(1), OutputStackProvider(1) {
@@ -20,24 +24,17 @@ namespace Fac {
         void setMaxItemStacks(int const max_item_stacks) {
             _max_item_stacks = max_item_stacks;
             _content_stacks.resize(max_item_stacks);
+            reindex();
         }
 
         // api to check if an amount of items can fit in the storage
         bool canStore(int const amount, Resource const &r) const {
-            return std::ranges::any_of(_content_stacks, [&](Stack const &s) {
-                return s.isEmpty() || s.canAdd(amount, r);
-            });
+            return getRoom(r) >= amount;
         }
 
         // get the total amount of items of a requested resource
         int getAmount(Resource const &r) const {
-            auto content = std::accumulate(_content_stacks.begin(), _content_stacks.end(), 0,
-                                   [&](int const acc, Stack const &s) {
-                                       if (s.isEmpty()) {
-                                           return acc;
-                                       }
-                                       return s.getResource() == r ? acc + s.getAmount() : acc;
-                                   });
+            auto content = _stacks_by_resource[r].amount;
             // also include the 5 items in the output stack for amount calculation
             if (getOutputStack(0)->getResource() == r) {
                 content += getOutputStack(0)->getAmount();
@@ -46,7 +43,17 @@ namespace Fac {
             return content;
         }
 
-        // TODO get inventory API
+        // the amounts of all resources in the storage, including the output stack
+        [[nodiscard]] Inventory getInventory() const {
+            auto result = Inventory();
+            _stacks_by_resource.forEach([&result](Resource const r, ResourceStacks const &stacks) {
+                result[r] = stacks.amount;
+            });
+            if (auto const &output = outputStack(0); !output.isEmpty()) {
+                result[output.getResource()] += output.getAmount();
+            }
+            return result;
+        }
 
         // TODO better API / Tests
         void manualAdd(int const amount, Resource const &r) const {
@@ -55,15 +62,46 @@ namespace Fac {
             }
         }
 
+        // puts as many of the items as there is room for into the content stacks, without the input,
+        // e.g. for the production of time that was not simulated. Returns the number of stored items
+        int storeAmount(int amount, Resource const &r);
+
 
         void update(double dt) override;
-        
+
+        [[nodiscard]] double getSleepTime() const override;
+
+        void watchStacks(std::shared_ptr<SleepState> const &state) const override;
+
         int getId() const override { return _id; }
 
     private:
+        // the content stacks holding a resource, all of them are full except for the last one
+        struct ResourceStacks {
+            int amount = 0;
+            std::vector<size_t> stacks;
+        };
+
+        // the number of items of the resource that fit into the content stacks
+        [[nodiscard]] int getRoom(Resource const &r) const;
+
+        // the index of an empty content stack, if there is one or a new one can be added
+        std::optional<size_t> takeEmptyStack();
+
+        // moves the items of the input into the content stacks
+        void store(Stack &input);
+
+        // moves content items into the output stack
+        void feed(Stack &output);
+
+        // rebuilds the index after the content stacks were replaced
+        void reindex();
+
         int _id = generate_id();
         std::vector<Stack> _content_stacks = std::vector<Stack>();
         int _max_item_stacks = 0;
+        ResourceArray<ResourceStacks> _stacks_by_resource;
+        std::vector<size_t> _empty_stacks;
     };
 } // Fac
 
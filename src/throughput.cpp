@@ -0,0 +1,361 @@
+#include "throughput.h"
+
+#include <algorithm>
+#include <limits>
+#include <ranges>
+#include <span>
+
+using namespace Fac;
+
+static constexpr double UNLIMITED = std::numeric_limits<double>::infinity();
+static constexpr double EPSILON = 1e-9;
+
+// shares the total between two sides, a side that can take less than half hands the rest to the other
+static std::pair<double, double> share(double const total, double const cap0, double const cap1) {
+    auto const first = std::min(cap0, std::max(total / 2, total - cap1));
+    return {first, std::min(cap1, total - first)};
+}
+
+Throughput::Throughput(Factory const &factory) {
+    addNodes<Extractor>(factory, Kind::Extractor);
+    addNodes<Storage>(factory, Kind::Storage);
+    addNodes<Machine>(factory, Kind::Machine);
+    addNodes<Belt>(factory, Kind::Belt);
+    addNodes<Splitter>(factory, Kind::Splitter);
+    addNodes<Merger>(factory, Kind::Merger);
+
+    for (int i = 0; i < _inputs.size(); i++) {
+        auto const [source_id, source_slot] = _links[i];
+        if (auto const source = _index.find(source_id); source_id != 0 && source != _index.end()) {
+            if (auto const &node = _nodes[source->second]; source_slot < node.outputs) {
+                _inputs[i].source = node.first_output + source_slot;
+                _outputs[_inputs[i].source].consumers++;
+            }
+        }
+    }
+
+    sortTopologically();
+
+    for (auto const n: _order) {
+        solveSupply(_nodes[n]);
+    }
+    for (auto const n: _order | std::views::reverse) {
+        solveDemand(_nodes[n]);
+    }
+    for (auto const n: _order) {
+        solveFlow(_nodes[n]);
+    }
+}
+
+template<typename T>
+void Throughput::addNodes(Factory const &factory, Kind const kind) {
+    for (auto const &e: factory.getEntityArray<T>()) {
+        _index[e->getId()] = static_cast<int>(_nodes.size());
+        auto &node = _nodes.emplace_back(Node{.kind = kind});
+        node.first_input = static_cast<int>(_inputs.size());
+        node.first_output = static_cast<int>(_outputs.size());
+
+        if constexpr (std::is_same_v<T, Extractor>) {
+            node.outputs = 1;
+            if (e->hasResourceNode() && e->getResourceNode()->getResource() != Resource::None) {
+                node.capacity = e->getOutputRpm();
+            }
+        } else if constexpr (std::is_same_v<T, Storage>) {
+            node.inputs = 1;
+            node.outputs = 1;
+            node.capacity = UNLIMITED;
+        } else if constexpr (std::is_same_v<T, Machine>) {
+            node.inputs = e->getInputSlots();
+            node.outputs = e->getOutputSlots();
+        } else {
+            node.inputs = std::is_same_v<T, Merger> ? 2 : 1;
+            node.outputs = std::is_same_v<T, Splitter> ? 2 : 1;
+            node.capacity = e->getItemsPerSecond() * 60.0;
+        }
+
+        if constexpr (!std::is_same_v<T, Extractor>) {
+            for (int i = 0; i < node.inputs; i++) {
+                auto const &connection = e->getInputConnection(i);
+                _links.emplace_back(connection.sourceId, connection.sourceOutputSlot);
+                _inputs.emplace_back();
+            }
+        }
+        _outputs.resize(_outputs.size() + node.outputs);
+
+        if constexpr (std::is_same_v<T, Machine>) {
+            // slots the recipe does not use take and give nothing
+            auto const &recipe = e->getRecipe();
+            for (int i = 0; i < node.inputs; i++) {
+                auto const used = recipe.has_value() && i < recipe->inputs.size();
+                _inputs[node.first_input + i].amount = used ? recipe->inputs[i].amount : 0;
+            }
+            for (int i = 0; i < node.outputs; i++) {
+                auto const used = recipe.has_value() && i < recipe->products.size();
+                _outputs[node.first_output + i].amount = used ? recipe->products[i].amount : 0;
+            }
+            if (recipe.has_value() && recipe->processing_time_s > 0) {
+                node.capacity = 60.0 / recipe->processing_time_s;
+            }
+        }
+    }
+}
+
+void Throughput::sortTopologically() {
+    // the consuming input slots of every output slot
+    std::vector<int> consumer_offsets(_outputs.size() + 1, 0);
+    for (auto const &input: _inputs) {
+        if (input.source >= 0) {
+            consumer_offsets[input.source + 1]++;
+        }
+    }
+    for (int i = 0; i < _outputs.size(); i++) {
+        consumer_offsets[i + 1] += consumer_offsets[i];
+    }
+    std::vector<int> consumers(consumer_offsets.back());
+    std::vector<int> input_node(_inputs.size());
+    auto next = consumer_offsets;
+    std::vector<int> missing_inputs(_nodes.size(), 0);
+    for (int n = 0; n < _nodes.size(); n++) {
+        for (int i = _nodes[n].first_input; i < _nodes[n].first_input + _nodes[n].inputs; i++) {
+            input_node[i] = n;
+            if (_inputs[i].source >= 0) {
+                consumers[next[_inputs[i].source]++] = i;
+                missing_inputs[n]++;
+            }
+        }
+    }
+
+    _order.clear();
+    _order.reserve(_nodes.size());
+    for (int n = 0; n < _nodes.size(); n++) {
+        if (missing_inputs[n] == 0) {
+            _order.push_back(n);
+        }
+    }
+    for (int k = 0; k < _order.size(); k++) {
+        auto const &node = _nodes[_order[k]];
+        for (int o = node.first_output; o < node.first_output + node.outputs; o++) {
+            for (int c = consumer_offsets[o]; c < consumer_offsets[o + 1]; c++) {
+                if (auto const n = input_node[consumers[c]]; --missing_inputs[n] == 0) {
+                    _order.push_back(n);
+                }
+            }
+        }
+    }
+
+    // feedback loops never run out of missing inputs, they are solved in update order
+    if (_order.size() < _nodes.size()) {
+        for (int n = 0; n < _nodes.size(); n++) {
+            if (missing_inputs[n] > 0) {
+                _order.push_back(n);
+            }
+        }
+    }
+
+    // demand is gathered from the consumers, an input that has not been solved yet does not limit
+    for (auto &input: _inputs) {
+        input.demand = UNLIMITED;
+    }
+    _consumer_offsets = std::move(consumer_offsets);
+    _consumers = std::move(consumers);
+}
+
+void Throughput::solveSupply(Node &node) {
+    auto const inputs = std::span(_inputs).subspan(node.first_input, node.inputs);
+    auto const outputs = std::span(_outputs).subspan(node.first_output, node.outputs);
+
+    for (auto &input: inputs) {
+        input.supply = input.source >= 0 ? _outputs[input.source].supply / _outputs[input.source].consumers : 0;
+    }
+
+    switch (node.kind) {
+        case Kind::Extractor:
+            node.supplied = node.capacity;
+            outputs[0].supply = node.supplied;
+            break;
+        case Kind::Storage:
+            node.supplied = inputs[0].supply;
+            outputs[0].supply = node.supplied;
+            break;
+        case Kind::Machine:
+            node.supplied = node.capacity;
+            for (auto const &input: inputs) {
+                if (input.amount > 0) {
+                    node.supplied = std::min(node.supplied, input.supply / input.amount);
+                }
+            }
+            for (auto &output: outputs) {
+                output.supply = node.supplied * output.amount;
+            }
+            break;
+        case Kind::Belt:
+        case Kind::Merger: {
+            auto total = 0.0;
+            for (auto const &input: inputs) {
+                total += input.supply;
+            }
+            node.supplied = std::min(node.capacity, total);
+            outputs[0].supply = node.supplied;
+            break;
+        }
+        case Kind::Splitter: {
+            node.supplied = std::min(node.capacity, inputs[0].supply);
+            // an output nobody takes from is full after the first item
+            auto const [first, second] = share(node.supplied,
+                                               outputs[0].consumers > 0 ? UNLIMITED : 0,
+                                               outputs[1].consumers > 0 ? UNLIMITED : 0);
+            outputs[0].supply = first;
+            outputs[1].supply = second;
+            break;
+        }
+    }
+}
+
+void Throughput::solveDemand(Node &node) {
+    auto const inputs = std::span(_inputs).subspan(node.first_input, node.inputs);
+    auto const outputs = std::span(_outputs).subspan(node.first_output, node.outputs);
+
+    for (int o = 0; o < outputs.size(); o++) {
+        outputs[o].demand = 0;
+        for (int c = _consumer_offsets[node.first_output + o]; c < _consumer_offsets[node.first_output + o + 1]; c++) {
+            outputs[o].demand += _inputs[_consumers[c]].demand;
+        }
+    }
+
+    switch (node.kind) {
+        case Kind::Extractor:
+            break;
+        case Kind::Storage:
+            inputs[0].demand = UNLIMITED;
+            break;
+        case Kind::Machine: {
+            auto crafts = node.supplied;
+            for (auto const &output: outputs) {
+                if (output.amount > 0) {
+                    crafts = std::min(crafts, output.demand / output.amount);
+                }
+            }
+            for (auto &input: inputs) {
+                input.demand = crafts * input.amount;
+            }
+            break;
+        }
+        case Kind::Belt:
+            inputs[0].demand = std::min(node.capacity, outputs[0].demand);
+            break;
+        case Kind::Splitter:
+            inputs[0].demand = std::min(node.capacity, outputs[0].demand + outputs[1].demand);
+            break;
+        case Kind::Merger: {
+            auto const [first, second] = share(std::min(node.capacity, outputs[0].demand),
+                                               inputs[0].supply, inputs[1].supply);
+            inputs[0].demand = first;
+            inputs[1].demand = second;
+            break;
+        }
+    }
+}
+
+void Throughput::solveFlow(Node &node) {
+    auto const inputs = std::span(_inputs).subspan(node.first_input, node.inputs);
+    auto const outputs = std::span(_outputs).subspan(node.first_output, node.outputs);
+
+    // what arrives at the inputs, before the entity takes its share
+    for (auto &input: inputs) {
+        auto const arriving = input.source >= 0 ? _outputs[input.source].flow / _outputs[input.source].consumers : 0;
+        input.flow = std::min(arriving, input.demand);
+    }
+
+    switch (node.kind) {
+        case Kind::Extractor:
+            node.throughput = std::min(node.capacity, outputs[0].demand);
+            outputs[0].flow = node.throughput;
+            break;
+        case Kind::Storage:
+            node.throughput = inputs[0].flow;
+            outputs[0].flow = std::min(node.throughput, outputs[0].demand);
+            break;
+        case Kind::Machine:
+            node.throughput = node.capacity;
+            for (auto const &input: inputs) {
+                if (input.amount > 0) {
+                    node.throughput = std::min(node.throughput, input.flow / input.amount);
+                }
+            }
+            for (auto const &output: outputs) {
+                if (output.amount > 0) {
+                    node.throughput = std::min(node.throughput, output.demand / output.amount);
+                }
+            }
+            for (auto &input: inputs) {
+                input.flow = node.throughput * input.amount;
+            }
+            for (auto &output: outputs) {
+                output.flow = node.throughput * output.amount;
+            }
+            break;
+        case Kind::Belt:
+            node.throughput = std::min({node.capacity, inputs[0].flow, outputs[0].demand});
+            inputs[0].flow = node.throughput;
+            outputs[0].flow = node.throughput;
+            break;
+        case Kind::Splitter: {
+            node.throughput = std::min({node.capacity, inputs[0].flow, outputs[0].demand + outputs[1].demand});
+            inputs[0].flow = node.throughput;
+            auto const [first, second] = share(node.throughput, outputs[0].demand, outputs[1].demand);
+            outputs[0].flow = first;
+            outputs[1].flow = second;
+            break;
+        }
+        case Kind::Merger: {
+            node.throughput = std::min({node.capacity, inputs[0].flow + inputs[1].flow, outputs[0].demand});
+            auto const [first, second] = share(node.throughput, inputs[0].flow, inputs[1].flow);
+            inputs[0].flow = first;
+            inputs[1].flow = second;
+            outputs[0].flow = node.throughput;
+            break;
+        }
+    }
+}
+
+Throughput::Node const *Throughput::find(int const entity_id) const {
+    auto const it = _index.find(entity_id);
+    return it == _index.end() ? nullptr : &_nodes[it->second];
+}
+
+double Throughput::getOutputRpm(int const entity_id, int const slot) const {
+    auto const node = find(entity_id);
+    return node != nullptr && slot < node->outputs ? _outputs[node->first_output + slot].flow : 0;
+}
+
+double Throughput::getInputRpm(int const entity_id, int const slot) const {
+    auto const node = find(entity_id);
+    return node != nullptr && slot < node->inputs ? _inputs[node->first_input + slot].flow : 0;
+}
+
+bool Throughput::isStarved(int const entity_id) const {
+    auto const node = find(entity_id);
+    return node != nullptr && node->capacity != UNLIMITED && node->supplied < node->capacity - EPSILON;
+}
+
+bool Throughput::isBlocked(int const entity_id) const {
+    auto const node = find(entity_id);
+    return node != nullptr && node->throughput < node->supplied - EPSILON;
+}
+
+ResourceArray<double> Throughput::getProductionRpm(Factory const &factory) const {
+    ResourceArray<double> result;
+    for (auto const &e: factory.getEntityArray<Extractor>()) {
+        if (e->hasResourceNode() && e->getResourceNode()->getResource() != Resource::None) {
+            result[e->getResourceNode()->getResource()] += getOutputRpm(e->getId());
+        }
+    }
+    for (auto const &m: factory.getEntityArray<Machine>()) {
+        if (auto const &recipe = m->getRecipe(); recipe.has_value()) {
+            for (int i = 0; i < recipe->products.size(); i++) {
+                result[recipe->products[i].resource] += getOutputRpm(m->getId(), i);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,115 @@
+#ifndef THROUGHPUT_H
+#define THROUGHPUT_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "sim.h"
+
+namespace Fac {
+    /**
+     * Throughput
+     * ----------
+     * Steady state items per minute of every entity of a Factory, computed from the connection
+     * graph instead of simulating it.
+     *
+     * The graph is solved in three passes over the entities in topological order:
+     * - supply: what the upstream entities can deliver, capped by extractor speeds, belt speeds
+     *   and recipes (a machine lacking one input is starved)
+     * - demand: what the downstream entities can take, walking the graph backwards. Outputs
+     *   nobody is connected to fill up and block, storages take everything
+     * - flow: the supply, capped by the demand
+     *
+     * Splitters and mergers share their items evenly, an output or input that needs less hands
+     * the rest to the other side. Entities in a feedback loop only see the supply of the loop
+     * entities that come before them in the update order.
+     */
+    class Throughput {
+    public:
+        explicit Throughput(Factory const &factory);
+
+        // items per minute leaving the given output slot
+        [[nodiscard]] double getOutputRpm(int entity_id, int slot = 0) const;
+
+        // items per minute entering the given input slot
+        [[nodiscard]] double getInputRpm(int entity_id, int slot = 0) const;
+
+        // runs below its own speed, because the inputs deliver too little
+        [[nodiscard]] bool isStarved(int entity_id) const;
+
+        // runs below what its inputs deliver, because the outputs take too little
+        [[nodiscard]] bool isBlocked(int entity_id) const;
+
+        // items per minute the machines and extractors of the factory produce, per resource
+        [[nodiscard]] ResourceArray<double> getProductionRpm(Factory const &factory) const;
+
+    private:
+        enum class Kind {
+            Extractor,
+            Storage,
+            Machine,
+            Belt,
+            Splitter,
+            Merger,
+        };
+
+        struct Node {
+            Kind kind;
+            int first_input = 0;
+            int inputs = 0;
+            int first_output = 0;
+            int outputs = 0;
+            // items (crafts for machines) per minute the entity can handle on its own
+            double capacity = 0;
+            // what the entity can do with the supply of its inputs
+            double supplied = 0;
+            // what the entity actually does
+            double throughput = 0;
+        };
+
+        struct InputSlot {
+            // global index of the connected output slot, -1 if not connected
+            int source = -1;
+            // items per craft, 1 for everything but machines
+            double amount = 1;
+            double supply = 0;
+            double demand = 0;
+            double flow = 0;
+        };
+
+        struct OutputSlot {
+            double amount = 1;
+            int consumers = 0;
+            double supply = 0;
+            double demand = 0;
+            double flow = 0;
+        };
+
+        template<typename T>
+        void addNodes(Factory const &factory, Kind kind);
+
+        void sortTopologically();
+
+        void solveSupply(Node &node);
+
+        void solveDemand(Node &node);
+
+        void solveFlow(Node &node);
+
+        [[nodiscard]] Node const *find(int entity_id) const;
+
+        std::vector<Node> _nodes;
+        std::vector<int> _order;
+        std::vector<InputSlot> _inputs;
+        std::vector<OutputSlot> _outputs;
+        // the link ids of the inputs, resolved to output slots once all nodes exist
+        std::vector<std::pair<int, int> > _links;
+        // the consuming input slots of every output slot, the consumers of output o are
+        // _consumers[_consumer_offsets[o]] to _consumers[_consumer_offsets[o + 1] - 1]
+        std::vector<int> _consumer_offsets;
+        std::vector<int> _consumers;
+        std::unordered_map<int, int> _index;
+    };
+}
+
+#endif //THROUGHPUT_H
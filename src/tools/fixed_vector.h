@@ -0,0 +1,65 @@
+#ifndef FIXED_VECTOR_H
+#define FIXED_VECTOR_H
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+
+/**
+ * FixedVector
+ * -----------
+ * A vector with a capacity that is fixed at compile time. The elements live inside the object,
+ * so it can be constexpr and is copied without allocating.
+ */
+template<typename T, std::size_t N>
+class FixedVector {
+public:
+    constexpr FixedVector() = default;
+
+    constexpr FixedVector(std::initializer_list<T> const values) {
+        for (auto const &value: values) {
+            push_back(value);
+        }
+    }
+
+    constexpr void push_back(T const &value) {
+        if (_size == N) {
+            throw std::length_error("FixedVector is full");
+        }
+        _values[_size++] = value;
+    }
+
+    constexpr void resize(std::size_t const size) {
+        if (size > N) {
+            throw std::length_error("FixedVector is too small");
+        }
+        for (auto i = _size; i < size; i++) {
+            _values[i] = T{};
+        }
+        _size = size;
+    }
+
+    constexpr void clear() { _size = 0; }
+
+    [[nodiscard]] constexpr std::size_t size() const { return _size; }
+    [[nodiscard]] constexpr bool empty() const { return _size == 0; }
+    [[nodiscard]] static constexpr std::size_t capacity() { return N; }
+
+    constexpr T &operator[](std::size_t const i) { return _values[i]; }
+    constexpr T const &operator[](std::size_t const i) const { return _values[i]; }
+
+    constexpr T &front() { return _values[0]; }
+    constexpr T const &front() const { return _values[0]; }
+
+    constexpr T *begin() { return _values.data(); }
+    constexpr T *end() { return _values.data() + _size; }
+    constexpr T const *begin() const { return _values.data(); }
+    constexpr T const *end() const { return _values.data() + _size; }
+
+private:
+    std::array<T, N> _values{};
+    std::size_t _size = 0;
+};
+
+#endif //FIXED_VECTOR_H
@@ -40,6 +40,7 @@ void generate_resources_header_file(const std::string &json_file_path, const std
     std::ofstream out(output_file_path);
     out << "#ifndef RESOURCES_H\n";
     out << "#define RESOURCES_H\n\n";
+    out << "#include <cstddef>\n";
     out << "#include <string_view>\n";
     out << "namespace Fac {\n";
     out << "enum class Resource {\n";
@@ -47,6 +48,8 @@ void generate_resources_header_file(const std::string &json_file_path, const std
         out << "\t" << resource.get<std::string>() << ",\n";
     }
     out << "};\n";
+    out << "// the number of resources, the values of Resource are 0 to RESOURCE_COUNT - 1\n";
+    out << "constexpr std::size_t RESOURCE_COUNT = " << j["enum"].size() << ";\n";
     out << "constexpr std::string_view resourceToString(Resource const r) {\n";
     out << "\tswitch (r) {\n";
     for (const auto &resource: j["enum"]) {
@@ -86,7 +89,8 @@ void generate_resources_header_file(const std::string &json_file_path, const std
             }
         ]
     }
- * The output will a map of the Recipe struct instances
+ * The output will be a RecipeId enum, a constexpr Recipe instance per recipe and a table of
+ * all recipes indexed by RecipeId, none of them allocate
  *
  */
 
@@ -109,11 +113,18 @@ void generate_recipes_header_file(const std::string &json_file_path, const std::
     std::ofstream out(output_file_path);
     out << "#ifndef RECIPES_H\n";
     out << "#define RECIPES_H\n\n";
+    out << "#include <array>\n";
     out << "#include \"resources.h\"\n";
     out << "#include \"../core.h\"\n";
     out << "namespace Fac {\n";
+    out << "enum class RecipeId {\n";
     for (const auto &recipe: j) {
-        out << "inline Recipe recipe_" << recipe["id"].get<std::string>() << " = {\n";
+        out << "\t" << recipe["id"].get<std::string>() << ",\n";
+    }
+    out << "};\n";
+    out << "constexpr std::size_t RECIPE_COUNT = " << j.size() << ";\n";
+    for (const auto &recipe: j) {
+        out << "inline constexpr Recipe recipe_" << recipe["id"].get<std::string>() << " = {\n";
         out << "\t.inputs = {\n";
         for (const auto &input: recipe["inputs"]) {
             out << "\t\t{Resource::" << input["resource"].get<std::string>() << ", " << input["amount"].get<int>() << "},\n";
@@ -127,6 +138,15 @@ void generate_recipes_header_file(const std::string &json_file_path, const std::
         out << "\t.processing_time_s = " << recipe["time"].get<int>() << "\n";
         out << "};\n";
     }
+    out << "// all recipes, indexed by RecipeId\n";
+    out << "inline constexpr std::array<Recipe, RECIPE_COUNT> RECIPES = {\n";
+    for (const auto &recipe: j) {
+        out << "\trecipe_" << recipe["id"].get<std::string>() << ",\n";
+    }
+    out << "};\n";
+    out << "constexpr Recipe const &recipeById(RecipeId const id) {\n";
+    out << "\treturn RECIPES[static_cast<std::size_t>(id)];\n";
+    out << "}\n";
 
     out << "} // Fac\n";
     out << "#endif //RECIPES_H\n";
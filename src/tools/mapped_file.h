@@ -0,0 +1,55 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A read only view of a whole file. The pages are loaded by the OS when they are accessed,
+// nothing is copied into the process up front.
+class MappedFile {
+public:
+    explicit MappedFile(std::string const &path) {
+        auto const fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::runtime_error("Could not open file: " + path);
+        }
+        struct stat info{};
+        if (fstat(fd, &info) == -1) {
+            close(fd);
+            throw std::runtime_error("Could not read file: " + path);
+        }
+        _size = static_cast<size_t>(info.st_size);
+        if (_size > 0) {
+            _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (_data == MAP_FAILED) {
+            throw std::runtime_error("Could not map file: " + path);
+        }
+    }
+
+    MappedFile(MappedFile const &) = delete;
+
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    ~MappedFile() {
+        if (_data != nullptr) {
+            munmap(_data, _size);
+        }
+    }
+
+    [[nodiscard]] std::span<char const> data() const {
+        return {static_cast<char const *>(_data), _size};
+    }
+
+private:
+    void *_data = nullptr;
+    size_t _size = 0;
+};
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,177 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * ThreadPool
+ * ----------
+ * A fixed set of worker threads for running independent jobs in parallel, e.g. the update of
+ * every factory in a frame. forEach blocks until all jobs are done, the calling thread helps.
+ * Jobs are handed out one by one, so a few slow jobs do not hold up the fast ones. A job that throws
+ * does not stop the others, forEach rethrows the first exception once all jobs are done.
+ *
+ * Only one forEach uses the workers at a time. A forEach that is called while the pool is busy,
+ * e.g. from inside one of its jobs, runs its jobs on the calling thread. A forEach of a single job
+ * runs it on the calling thread without taking the pool, so a forEach inside that job still gets
+ * the workers.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned const threads = std::max(1u, std::thread::hardware_concurrency())) {
+        // the calling thread is one of the workers
+        for (unsigned i = 1; i < threads; i++) {
+            _workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPool(ThreadPool const &) = delete;
+
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        for (auto &worker: _workers) {
+            worker.join();
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return _workers.size() + 1; }
+
+    // the number of forEach calls that ran their jobs on the workers
+    [[nodiscard]] size_t getParallelRuns() const { return _parallel_runs; }
+
+    // calls job(i) for every i in [0, count) and returns when all calls are done
+    void forEach(size_t const count, std::function<void(size_t)> const &job) {
+        if (count == 0) {
+            return;
+        }
+        auto idle = false;
+        if (_workers.empty() || count == 1 || !_busy.compare_exchange_strong(idle, true)) {
+            std::exception_ptr error;
+            for (size_t i = 0; i < count; i++) {
+                run(job, i, error);
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return;
+        }
+        // hands the workers to the next forEach, also when a job threw
+        struct Release {
+            std::atomic<bool> &busy;
+            ~Release() { busy = false; }
+        } const release{_busy};
+        _parallel_runs++;
+
+        {
+            std::unique_lock lock(_mutex);
+            // workers still leaving the previous forEach must not pick up the new jobs
+            _finished.wait(lock, [this] { return _active == 0; });
+            _job = &job;
+            _count = count;
+            _next = 0;
+            _done = 0;
+            _error = nullptr;
+            _generation++;
+        }
+        _wake.notify_all();
+
+        auto const finished = runJobs(job, count);
+
+        std::unique_lock lock(_mutex);
+        _done += finished;
+        _finished.wait(lock, [this] { return _done == _count && _active == 0; });
+        _job = nullptr;
+        if (_error) {
+            std::rethrow_exception(std::exchange(_error, nullptr));
+        }
+    }
+
+private:
+    void work() {
+        unsigned seen_generation = 0;
+        while (true) {
+            std::function<void(size_t)> const *job;
+            size_t count;
+            {
+                std::unique_lock lock(_mutex);
+                _wake.wait(lock, [&] { return _stopping || _generation != seen_generation; });
+                if (_stopping) {
+                    return;
+                }
+                seen_generation = _generation;
+                job = _job;
+                count = _count;
+                _active++;
+            }
+            auto const finished = job != nullptr ? runJobs(*job, count) : 0;
+            {
+                std::lock_guard lock(_mutex);
+                _done += finished;
+                _active--;
+            }
+            _finished.notify_all();
+        }
+    }
+
+    // takes jobs until none are left, returns the number of jobs done
+    size_t runJobs(std::function<void(size_t)> const &job, size_t const count) {
+        size_t finished = 0;
+        std::exception_ptr error;
+        for (auto i = _next++; i < count; i = _next++) {
+            run(job, i, error);
+            finished++;
+        }
+        if (error) {
+            std::lock_guard lock(_mutex);
+            if (!_error) {
+                _error = error;
+            }
+        }
+        return finished;
+    }
+
+    // keeps the first exception of the jobs in error
+    static void run(std::function<void(size_t)> const &job, size_t const i, std::exception_ptr &error) {
+        try {
+            job(i);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    std::vector<std::thread> _workers;
+    // set by the forEach that currently uses the workers
+    std::atomic<bool> _busy = false;
+    std::atomic<size_t> _parallel_runs = 0;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _finished;
+    std::function<void(size_t)> const *_job = nullptr;
+    size_t _count = 0;
+    std::atomic<size_t> _next = 0;
+    size_t _done = 0;
+    // the first exception of a job in the current forEach
+    std::exception_ptr _error;
+    // workers between taking a job list and reporting it as done
+    int _active = 0;
+    unsigned _generation = 0;
+    bool _stopping = false;
+};
+
+#endif //THREAD_POOL_H
@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <filesystem>
+
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+#include "../src/game/autosave.h"
+#include "../src/game/simulation.h"
+
+using namespace Fac;
+
+TEST(Autosave, WritesTheSnapshotInTheBackground) {
+    auto const file = testing::TempDir() + "autosave.sav";
+    auto state = GameState();
+    state.credits = 10;
+    state.addFactory(std::make_shared<Factory>());
+
+    auto autosave = Autosave(file);
+    autosave.save(state);
+    // changes after the snapshot are not part of the save
+    state.credits = 20;
+    autosave.flush();
+
+    EXPECT_EQ(autosave.getSavesWritten(), 1);
+    EXPECT_FALSE(std::filesystem::exists(file + ".tmp"));
+    auto const loaded = loadGameState(file);
+    EXPECT_EQ(loaded.credits, 10);
+    std::remove(file.c_str());
+}
+
+TEST(Autosave, WaitsForTheInterval) {
+    auto const file = testing::TempDir() + "autosave_interval.json";
+    auto state = GameState();
+
+    auto autosave = Autosave(file, std::chrono::hours(1));
+    autosave.update(state);
+    autosave.flush();
+    EXPECT_EQ(autosave.getSavesWritten(), 0);
+    EXPECT_FALSE(std::filesystem::exists(file));
+}
+
+TEST(Autosave, RunsBetweenTheTicksOfASimulation) {
+    auto const file = testing::TempDir() + "autosave_simulation.json";
+    auto state = GameState();
+    state.addFactory(std::make_shared<Factory>());
+
+    auto const autosave = std::make_shared<Autosave>(file, std::chrono::milliseconds(20));
+    auto simulation = Simulation(state, std::make_shared<ThreadPool>(2));
+    simulation.setAutosave(autosave);
+    simulation.start();
+    simulation.post([](GameState &s) { s.credits = 42; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    simulation.stop();
+    autosave->stop();
+
+    EXPECT_GT(autosave->getSavesWritten(), 0);
+    auto loaded = loadGameState(file);
+    EXPECT_EQ(loaded.credits, 42);
+    EXPECT_EQ(loaded.getFactories().size(), 1);
+    std::remove(file.c_str());
+}
@@ -30,8 +30,8 @@ TEST(Belt, ConnectTwoBelts) {
     w.advanceBy(5 * 60 * 1000, [&]() {
         EXPECT_EQ(m1->getInputStack(0)->getAmount(), 0);
         EXPECT_EQ(m2->getInputStack(0)->getAmount(), 1);
-        EXPECT_EQ(belt1->_in_transit_stack.size(), 0);
-        EXPECT_EQ(belt2->_in_transit_stack.size(), 0);
+        EXPECT_EQ(belt1->getItemCount(), 0);
+        EXPECT_EQ(belt2->getItemCount(), 0);
         EXPECT_FALSE(belt1->getJammed());
         EXPECT_FALSE(belt2->getJammed());
     });
@@ -73,7 +73,7 @@ TEST(Belt, ConnectTenBelts) {
         EXPECT_EQ(m1->getOutputStack(0)->getAmount(), 0);
         EXPECT_EQ(m2->getOutputStack(0)->getAmount(), 66);
         for (const auto &belt: belts) {
-            EXPECT_EQ(belt->_in_transit_stack.size(), 0);
+            EXPECT_EQ(belt->getItemCount(), 0);
             EXPECT_FALSE(belt->getJammed());
         }
     });
@@ -110,7 +110,7 @@ TEST(Belt, HasDifferentSpeed) {
     w.addEntity(storage);
 
     w.advanceBy((5 * 1000), [&]() {
-        EXPECT_EQ(machine->getOutputStack(0)->getAmount(), 50);
+        EXPECT_EQ(machine->getOutputStack(0)->getAmount(), 49);
         EXPECT_EQ(storage->getAmount(Resource::IronIngot), 49);
     });
 
@@ -119,3 +119,75 @@ TEST(Belt, HasDifferentSpeed) {
         EXPECT_EQ(storage->getAmount(Resource::IronIngot), 100);
     });
 }
+
+TEST(Belt, CarriesAsManyItemsAsItsLength) {
+    auto w = Factory();
+    auto machine = std::make_shared<Machine>(Machine());
+    machine->setRecipe(recipe_IronIngot);
+    machine->getOutputStack(0)->addAmount(100, Resource::IronIngot);
+
+    // 10 items per second on a lane of 5 items, every item needs 500 ms to pass
+    auto belt = std::make_shared<Belt>(10, 5);
+    EXPECT_EQ(belt->getLength(), 5);
+
+    auto storage = std::make_shared<Storage>(Storage());
+    storage->setMaxItemStacks(100);
+
+    storage->connectInput(0, belt, 0);
+    belt->connectInput(0, machine, 0);
+
+    w.addEntity(machine);
+    w.addEntity(belt);
+    w.addEntity(storage);
+
+    w.advanceBy(450, [&]() {
+        EXPECT_EQ(belt->getItemCount(), 5);
+        EXPECT_EQ(storage->getAmount(Resource::IronIngot), 0);
+    });
+
+    // a full lane delivers at the speed of the belt
+    w.advanceBy(1000, [&]() {
+        EXPECT_EQ(belt->getItemCount(), 5);
+        EXPECT_EQ(storage->getAmount(Resource::IronIngot), 10);
+        EXPECT_FALSE(belt->getJammed());
+    });
+}
+
+TEST(Belt, KeepsItsLaneWhenSaved) {
+    auto belt = Belt(2, 3);
+    belt.getInputStack(0)->addAmount(3, Resource::IronOre);
+    belt.update(1);
+    belt.update(500);
+    EXPECT_EQ(belt.getItemCount(), 2);
+
+    json j = belt;
+    auto loaded = j.get<Belt>();
+    EXPECT_EQ(loaded.getLength(), 3);
+    EXPECT_EQ(loaded.getItems(), belt.getItems());
+
+    // both continue the same way
+    for (auto *b: {&belt, &loaded}) {
+        b->update(500);
+        b->update(500);
+        b->update(500);
+    }
+    EXPECT_EQ(loaded.getItemCount(), belt.getItemCount());
+    EXPECT_EQ(loaded.getOutputStack(0)->getAmount(), belt.getOutputStack(0)->getAmount());
+    EXPECT_EQ(loaded.getOutputStack(0)->getAmount(), 1);
+}
+
+TEST(Belt, RejectsALaneThatDoesNotFit) {
+    auto belt = Belt(1, 2);
+    belt.getInputStack(0)->addAmount(1, Resource::IronOre);
+    belt.update(1);
+    json const j = belt;
+
+    auto empty = j;
+    empty["itemMover"]["length"] = 0;
+    EXPECT_THROW(empty.get<Belt>(), std::runtime_error);
+
+    auto overfull = j;
+    auto const item = overfull["itemMover"]["lane"][0];
+    overfull["itemMover"]["lane"] = json::array({item, item, item});
+    EXPECT_THROW(overfull.get<Belt>(), std::runtime_error);
+}
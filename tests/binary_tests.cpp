@@ -0,0 +1,296 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+#include "../src/binary.h"
+#include "../src/game/save.h"
+
+using namespace Fac;
+
+template<typename T>
+static T roundTrip(T const &value) {
+    auto w = BinaryWriter();
+    to_binary(w, value);
+    auto b = BinaryReader(w.data());
+    auto result = T();
+    from_binary(b, result);
+    EXPECT_TRUE(b.atEnd());
+    return result;
+}
+
+TEST(Binary, AStack) {
+    auto s = Stack();
+    s.addAmount(10, Resource::IronOre);
+    auto const s2 = roundTrip(s);
+    EXPECT_EQ(s2.getAmount(), 10);
+    EXPECT_EQ(s2.getResource(), Resource::IronOre);
+}
+
+TEST(Binary, Machine) {
+    auto m = Machine();
+    m.setRecipe(recipe_IronIngot);
+    m.getInputStack(0)->addAmount(10, Resource::IronOre);
+    m.getOutputStack(0)->addAmount(33, Resource::IronIngot);
+    auto const m2 = roundTrip(m);
+    EXPECT_EQ(m2.getId(), m.getId());
+    EXPECT_EQ(m2.getRecipe().value().inputs[0].amount, recipe_IronIngot.inputs[0].amount);
+    EXPECT_EQ(m2.getInputRpm(), m.getInputRpm());
+    EXPECT_EQ(m2.getInputStack(0)->getAmount(), 10);
+    EXPECT_EQ(m2.getOutputStack(0)->getAmount(), 33);
+    EXPECT_EQ(m2.getOutputStack(0)->getResource(), Resource::IronIngot);
+}
+
+TEST(Binary, LinkedFactoryContinuesLikeTheOriginal) {
+    auto w = Factory();
+    const auto s = std::make_shared<Storage>(Storage());
+    const auto belt1 = std::make_shared<Belt>(Belt(1));
+    const auto sp = std::make_shared<Splitter>(Splitter());
+    const auto belt2 = std::make_shared<Belt>(Belt(1));
+    const auto m1 = std::make_shared<Machine>(Machine());
+    s->setMaxItemStacks(1);
+    s->getInputStack(0)->addAmount(33, Resource::IronOre);
+    belt1->connectInput(0, s, 0);
+    sp->connectInput(0, belt1, 0);
+    belt2->connectInput(0, sp, 0);
+    m1->connectInput(0, belt2, 0);
+    m1->setRecipe(recipe_IronIngot);
+    w.addEntity(s);
+    w.addEntity(belt1);
+    w.addEntity(sp);
+    w.addEntity(belt2);
+    w.addEntity(m1);
+    w.advanceBy(9000, [](){});
+
+    auto writer = BinaryWriter();
+    to_binary(writer, w);
+    auto reader = BinaryReader(writer.data());
+    auto x = Factory();
+    from_binary(reader, x);
+
+    ASSERT_EQ(x.getEntities().size(), 5);
+    EXPECT_EQ(x.getEntities()[4]->getId(), m1->getId());
+    EXPECT_EQ(std::dynamic_pointer_cast<Storage>(x.getEntities()[0])->getAmount(Resource::IronOre), 23);
+
+    w.advanceBy(60000, [](){});
+    x.advanceBy(60000, [](){});
+    auto const m2 = std::dynamic_pointer_cast<Machine>(x.getEntities()[4]);
+    EXPECT_EQ(m2->getOutputStack(0)->getAmount(), m1->getOutputStack(0)->getAmount());
+    EXPECT_EQ(std::dynamic_pointer_cast<Storage>(x.getEntities()[0])->getAmount(Resource::IronOre),
+              s->getAmount(Resource::IronOre));
+}
+
+TEST(Binary, GameStateFile) {
+    auto state = GameState();
+    state.credits = 123.5;
+    state.resources[Resource::IronOre] = 7;
+    auto const f = std::make_shared<Factory>();
+    auto const m = std::make_shared<Machine>();
+    m->setRecipe(recipe_IronIngot);
+    m->getOutputStack(0)->addAmount(3, Resource::IronIngot);
+    f->addEntity(m);
+    state.addFactory(f);
+
+    auto const file = testing::TempDir() + "binary_game_state.sav";
+    saveGameState(state, file);
+    auto loaded = loadGameState(file);
+    std::remove(file.c_str());
+
+    EXPECT_EQ(loaded.credits, 123.5);
+    EXPECT_EQ(loaded.resources[Resource::IronOre], 7);
+    ASSERT_EQ(loaded.getFactories().size(), 1);
+    EXPECT_EQ(loaded.getFactories()[0]->getId(), f->getId());
+    auto const m2 = std::dynamic_pointer_cast<Machine>(loaded.getFactories()[0]->getEntities()[0]);
+    EXPECT_EQ(m2->getOutputStack(0)->getAmount(), 3);
+}
+
+// an extractor filling a storage
+static std::shared_ptr<Factory> oreFactory() {
+    auto const f = std::make_shared<Factory>();
+    auto const n = std::make_shared<ResourceNode>();
+    n->setResource(Resource::IronOre);
+    auto const e = std::make_shared<Extractor>();
+    e->setResourceNode(n);
+    auto const belt = std::make_shared<Belt>(Belt(1));
+    belt->connectInput(0, e, 0);
+    auto const s = std::make_shared<Storage>();
+    s->setMaxItemStacks(10);
+    s->connectInput(0, belt, 0);
+    f->addEntity(n);
+    f->addEntity(e);
+    f->addEntity(belt);
+    f->addEntity(s);
+    return f;
+}
+
+TEST(Binary, FactoriesStayStoredUntilNeeded) {
+    auto state = GameState();
+    auto const f1 = oreFactory();
+    auto const f2 = oreFactory();
+    state.addFactory(f1);
+    state.addFactory(f2);
+
+    auto const file = testing::TempDir() + "binary_stored_factories.sav";
+    saveGameState(state, file);
+    auto pool = ThreadPool(2);
+    auto loaded = loadGameStateLazily(file, pool);
+    std::remove(file.c_str());
+
+    EXPECT_TRUE(loaded.getFactories().empty());
+    ASSERT_EQ(loaded.getStoredFactories().size(), 2);
+
+    auto const f = loaded.getFactoryById(f2->getId());
+    ASSERT_NE(f, nullptr);
+    EXPECT_EQ(f->getEntities().size(), 4);
+    EXPECT_EQ(loaded.getFactories().size(), 1);
+    ASSERT_EQ(loaded.getStoredFactories().size(), 1);
+    EXPECT_EQ(loaded.getStoredFactories()[0].getId(), f1->getId());
+    EXPECT_EQ(loaded.getFactoryById(12345), nullptr);
+
+    loaded.loadFactories(pool);
+    EXPECT_EQ(loaded.getFactories().size(), 2);
+    EXPECT_TRUE(loaded.getStoredFactories().empty());
+}
+
+TEST(Binary, StoredFactoryCatchesUpWhenLoaded) {
+    auto stored = StoredFactory::of(*oreFactory());
+    stored.advance(60'000);
+    // 60 items per minute
+    EXPECT_EQ(stored.getProductionTotals()[Resource::IronOre], 60);
+
+    auto state = GameState();
+    state.addStoredFactory(stored);
+    auto const data = encodeGameState(state);
+    auto decoded = decodeGameState(data);
+    ASSERT_EQ(decoded.getStoredFactories().size(), 1);
+    EXPECT_EQ(decoded.getStoredFactories()[0].getStoredMs(), 60'000);
+
+    // the last 10 s are simulated, the 50 s before are credited from the estimate and their ore is stored
+    auto const f = decoded.getFactoryById(stored.getId());
+    EXPECT_NEAR(f->getProductionTotals()[Resource::IronOre], 60, 2);
+    EXPECT_NEAR(f->getEntityArray<Storage>().front()->getAmount(Resource::IronOre), 60, 4);
+}
+
+TEST(Binary, StoredFactoryEstimatesMostOfALongAbsence) {
+    auto stored = StoredFactory::of(*oreFactory());
+    stored.advance(24 * 3600 * 1000L);
+
+    // the storage of 10 stacks is full, the rest of the day's ore had no room
+    auto const f = stored.load();
+    auto const &storage = *f->getEntityArray<Storage>().front();
+    EXPECT_NEAR(f->getProductionTotals()[Resource::IronOre], 24 * 60 * 60, 2);
+    EXPECT_FALSE(storage.canStore(1, Resource::IronOre));
+    EXPECT_EQ(storage.getAmount(Resource::IronOre), 10 * MAX_STACK_SIZE + Storage::OUTPUT_STACK_SIZE);
+
+    // an export writes the factory as it was loaded, with the stored time
+    auto state = GameState();
+    state.addStoredFactory(stored);
+    json const j = state;
+    EXPECT_EQ(j["gameState"]["factories"][0], json(*f));
+    EXPECT_EQ(state.getStoredFactories()[0].getStoredMs(), 24 * 3600 * 1000L);
+}
+
+TEST(Binary, JsonSaveFilesStillLoad) {
+    auto state = GameState();
+    state.credits = 42;
+    auto const file = testing::TempDir() + "binary_game_state.json";
+    saveGameState(state, file);
+    auto const loaded = loadGameState(file);
+    std::remove(file.c_str());
+    EXPECT_EQ(loaded.credits, 42);
+}
+
+TEST(Binary, RejectsOtherData) {
+    auto const data = std::string("{\"gameState\": {}}");
+    auto b = BinaryReader(std::span(data.data(), data.size()));
+    EXPECT_FALSE(isBinarySave(std::span(data.data(), data.size())));
+    EXPECT_THROW(b.readHeader(), std::runtime_error);
+
+    auto w = BinaryWriter();
+    w.writeHeader();
+    auto truncated = BinaryReader(w.data());
+    truncated.readHeader();
+    EXPECT_THROW(truncated.read<std::int32_t>(), std::runtime_error);
+}
+
+TEST(Binary, RejectsABeltWithoutLength) {
+    auto const belt = Belt(1, 2);
+    auto w = BinaryWriter();
+    to_binary(w, belt);
+    auto data = w.data();
+    // the length follows the id, the speed, two flags and the name
+    auto const length_offset = 4 + 8 + 1 + 1 + 4 + belt.name.size();
+    std::int32_t saved_length;
+    std::memcpy(&saved_length, data.data() + length_offset, sizeof(saved_length));
+    ASSERT_EQ(saved_length, 2);
+    for (std::int32_t const length: {0, -5}) {
+        std::memcpy(data.data() + length_offset, &length, sizeof(length));
+        auto b = BinaryReader(data);
+        auto loaded = Belt();
+        EXPECT_THROW(from_binary(b, loaded), std::runtime_error);
+    }
+}
+
+// the encoding of the value with the int32 at offset replaced
+template<typename T>
+static std::vector<char> corrupted(T const &value, size_t const offset, std::int32_t const replacement) {
+    auto w = BinaryWriter();
+    to_binary(w, value);
+    auto data = w.data();
+    std::memcpy(data.data() + offset, &replacement, sizeof(replacement));
+    return data;
+}
+
+template<typename T>
+static void expectRejected(std::vector<char> const &data) {
+    auto b = BinaryReader(data);
+    auto loaded = T();
+    EXPECT_THROW(from_binary(b, loaded), std::runtime_error);
+}
+
+TEST(Binary, RejectsUnknownResources) {
+    auto node = ResourceNode();
+    node.setResource(Resource::IronOre, ResourceQuality::Pure);
+    // the resource and the quality follow the id
+    EXPECT_EQ(roundTrip(node).getResource(), Resource::IronOre);
+    {
+        // the offsets are the ones of the resource and the quality
+        auto const quality = corrupted(node, 8, static_cast<std::int32_t>(ResourceQuality::Impure));
+        auto b = BinaryReader(quality);
+        auto loaded = ResourceNode();
+        from_binary(b, loaded);
+        EXPECT_EQ(loaded.getQuality(), ResourceQuality::Impure);
+        auto const resource = corrupted(node, 4, static_cast<std::int32_t>(Resource::CopperOre));
+        auto b2 = BinaryReader(resource);
+        from_binary(b2, loaded);
+        EXPECT_EQ(loaded.getResource(), Resource::CopperOre);
+    }
+    expectRejected<ResourceNode>(corrupted(node, 4, 9999));
+    expectRejected<ResourceNode>(corrupted(node, 4, -2));
+    expectRejected<ResourceNode>(corrupted(node, 8, 3));
+
+    auto stack = Stack();
+    stack.addAmount(1, Resource::IronOre);
+    // the resource follows the id and the amount
+    expectRejected<Stack>(corrupted(stack, 8, static_cast<std::int32_t>(RESOURCE_COUNT)));
+}
+
+TEST(Binary, RejectsAMachineWhoseSlotsDoNotMatch) {
+    auto machine = Machine();
+    machine.setRecipe(recipe_IronIngot);
+    // the input and output slots follow the id, the processing state and the name
+    auto const slots_offset = 4 + 1 + 8 + 4 + machine.name.size();
+    std::int32_t saved_slots;
+    auto const encoded = corrupted(machine, 0, machine.getId());
+    std::memcpy(&saved_slots, encoded.data() + slots_offset, sizeof(saved_slots));
+    ASSERT_EQ(saved_slots, 1);
+    expectRejected<Machine>(corrupted(machine, slots_offset, 2));
+    expectRejected<Machine>(corrupted(machine, slots_offset + 4, 0));
+
+    auto w = BinaryWriter();
+    to_binary(w, machine);
+    auto truncated = w.data();
+    truncated.resize(truncated.size() - 3);
+    expectRejected<Machine>(truncated);
+}
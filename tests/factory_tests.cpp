@@ -29,4 +29,30 @@ TEST(Factory, GetEntitiesByType) {
     EXPECT_EQ(belts.size(), 1);
     EXPECT_EQ(belts[0]->getId(), b->getId());
 
-}
\ No newline at end of file
+}
+
+TEST(Factory, AddAndRemoveEntityByBasePointer) {
+    auto f = Factory();
+    const std::shared_ptr<GameWorldEntity> b = std::make_shared<Belt>(Belt(1));
+    const auto m = std::make_shared<Machine>(Machine());
+    f.addEntity(b);
+    f.addEntity(m);
+    EXPECT_EQ(f.getEntitiesByType<Belt>().size(), 1);
+    EXPECT_EQ(f.getEntitiesByType<Belt>()[0]->getId(), b->getId());
+    EXPECT_EQ(f.getEntitiesByType<Machine>().size(), 1);
+
+    f.removeEntity(b);
+    EXPECT_EQ(f.getEntitiesByType<Belt>().size(), 0);
+    EXPECT_EQ(f.getEntities().size(), 1);
+}
+
+TEST(Factory, CountsProducedItems) {
+    auto f = Factory();
+    const auto m = std::make_shared<Machine>(Machine());
+    m->setRecipe(recipe_IronIngot);
+    m->getInputStack(0)->addAmount(10, Resource::IronOre);
+    f.addEntity(m);
+    f.step(5 * 1000);
+    EXPECT_EQ(f.getProductionTotals()[Resource::IronIngot], m->getOutputStack(0)->getAmount());
+    EXPECT_GT(f.getProductionTotals()[Resource::IronIngot], 0);
+}
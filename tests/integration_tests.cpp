@@ -25,19 +25,19 @@ TEST(TwoMachineProductionChain, WithSimpleBelt) {
     w.advanceBy(2000 + 100, [&]() {
         EXPECT_TRUE(m1->getOutputStack(0)->isEmpty());
         EXPECT_TRUE(m2->getInputStack(0)->isEmpty());
-        EXPECT_EQ(belt->_in_transit_stack.size(), 1);
+        EXPECT_EQ(belt->getItemCount(), 1);
     });
     // first ingot shipped
     w.advanceBy(1000, [&]() {
         EXPECT_TRUE(m1->getOutputStack(0)->isEmpty());
         EXPECT_EQ(m2->getInputStack(0)->getAmount(), 1);
-        EXPECT_EQ(belt->_in_transit_stack.size(), 0);
+        EXPECT_EQ(belt->getItemCount(), 0);
     });
     // somewhere in the middle of production
     w.advanceBy(105333, [&]() {
         EXPECT_EQ(m1->getInputStack(0)->getAmount(), 45);
         EXPECT_EQ(m2->getOutputStack(0)->getAmount(), 32);
-        EXPECT_EQ(belt->_in_transit_stack.size(), 1);
+        EXPECT_EQ(belt->getItemCount(), 1);
     });
     // first machine is finished last ingot shipping
     w.advanceBy(90000, [&]() {
@@ -45,14 +45,14 @@ TEST(TwoMachineProductionChain, WithSimpleBelt) {
         EXPECT_TRUE(m1->getOutputStack(0)->isEmpty());
        EXPECT_EQ(m2->getInputStack(0)->getAmount(), 2);
        EXPECT_EQ(m2->getOutputStack(0)->getAmount(), 62);
-       EXPECT_EQ(belt->_in_transit_stack.size(), 1);
+       EXPECT_EQ(belt->getItemCount(), 1);
    });
     // production finished with 66 plates
     w.advanceBy(7000, [&]() {
         EXPECT_EQ(m1->getInputStack(0)->getAmount(), 0);
         EXPECT_EQ(m2->getInputStack(0)->getAmount(), 1);
         EXPECT_EQ(m2->getOutputStack(0)->getAmount(), 66);
-        EXPECT_EQ(belt->_in_transit_stack.size(), 0);
+        EXPECT_EQ(belt->getItemCount(), 0);
     });
 }
 
@@ -88,7 +88,7 @@ TEST(DepositToMachine, WithSimpleBelt) {
         EXPECT_TRUE(m1->processing);
         EXPECT_EQ(m1->getInputStack(0)->getAmount(), 59);
         EXPECT_EQ(m1->getOutputStack(0)->getAmount(), 58);
-        EXPECT_EQ(belt1->_in_transit_stack.size(), 1);
+        EXPECT_EQ(belt1->getItemCount(), 1);
         EXPECT_FALSE(belt1->getJammed());
     });
 
@@ -98,7 +98,7 @@ TEST(DepositToMachine, WithSimpleBelt) {
         EXPECT_FALSE(m1->processing);
         EXPECT_EQ(m1->getInputStack(0)->getAmount(), 100);
         EXPECT_EQ(m1->getOutputStack(0)->getAmount(), 100);
-        EXPECT_EQ(belt1->_in_transit_stack.size(), 1);
+        EXPECT_EQ(belt1->getItemCount(), 1);
         EXPECT_TRUE(belt1->getJammed());
     });
 
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+
+using namespace Fac;
+
+TEST(Inventory, IsIndexedByResource) {
+    auto i = Inventory();
+    EXPECT_EQ(i[Resource::IronOre], 0);
+    i[Resource::IronOre] = 5;
+    i[Resource::Coal] += 2;
+    EXPECT_EQ(i[Resource::IronOre], 5);
+    EXPECT_EQ(i[Resource::Coal], 2);
+    EXPECT_EQ(i[Resource::CopperOre], 0);
+}
+
+TEST(Inventory, CanBeSummed) {
+    auto a = Inventory();
+    a[Resource::IronOre] = 5;
+    auto b = Inventory();
+    b[Resource::IronOre] = 1;
+    b[Resource::Coal] = 3;
+    auto const sum = a + b;
+    EXPECT_EQ(sum[Resource::IronOre], 6);
+    EXPECT_EQ(sum[Resource::Coal], 3);
+    a += b;
+    EXPECT_EQ(a, sum);
+}
+
+TEST(Inventory, KeepsTheJsonFormatOfAMap) {
+    auto i = Inventory();
+    i[Resource::IronOre] = 7;
+    json const j = i;
+    auto m = std::map<Resource, int>();
+    m[Resource::IronOre] = 7;
+    EXPECT_EQ(j, json(m));
+    EXPECT_EQ(json(m).get<Inventory>(), i);
+}
+
+TEST(Inventory, ListsTheContentOfAStorage) {
+    auto w = Factory();
+    const auto s = std::make_shared<Storage>(Storage());
+    s->setMaxItemStacks(2);
+    w.addEntity(s);
+    s->getInputStack(0)->addAmount(30, Resource::IronOre);
+    w.advanceBy(100, [] {});
+    s->getInputStack(0)->addAmount(10, Resource::Cable);
+    w.advanceBy(100, [] {});
+
+    auto const inventory = s->getInventory();
+    EXPECT_EQ(inventory[Resource::IronOre], 30);
+    EXPECT_EQ(inventory[Resource::Cable], 10);
+    EXPECT_EQ(inventory[Resource::IronOre], s->getAmount(Resource::IronOre));
+}
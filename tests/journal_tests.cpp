@@ -0,0 +1,221 @@
+#include <cstdio>
+#include <filesystem>
+
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+#include "../src/game/autosave.h"
+#include "../src/game/save.h"
+#include "../src/dsl/synthetic.h"
+
+using namespace Fac;
+
+// storages with ore, some of them on a belt
+static std::shared_ptr<Factory> storageFactory(int const storages) {
+    auto const f = std::make_shared<Factory>();
+    for (int i = 0; i < storages; i++) {
+        auto const s = std::make_shared<Storage>();
+        s->setMaxItemStacks(2);
+        s->manualAdd(i + 1, Resource::IronOre);
+        f->addEntity(s);
+    }
+    return f;
+}
+
+static std::shared_ptr<Storage> storage(Factory const &f, size_t const i) {
+    return f.getEntityArray<Storage>()[i];
+}
+
+static GameState replayed(std::vector<char> const &save, std::vector<char> const &journal) {
+    auto state = decodeGameState(save);
+    Journal::replay(journal, state);
+    auto pool = ThreadPool(1);
+    state.loadFactories(pool);
+    return state;
+}
+
+static std::vector<char> operator+(std::vector<char> a, std::vector<char> const &b) {
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+
+TEST(Journal, EntriesHoldOnlyTheChangedEntities) {
+    auto state = GameState();
+    auto const f = storageFactory(100);
+    state.addFactory(f);
+    auto journal = Journal();
+    auto const save = encodeGameState(state, &journal);
+    EXPECT_FALSE(journal.needsCompaction());
+
+    storage(*f, 7)->manualAdd(10, Resource::IronOre);
+    state.credits = 5;
+    auto const entry = journal.delta(state);
+    EXPECT_LT(entry.size() * 20, save.size());
+    // nothing changed since
+    EXPECT_LT(journal.delta(state).size(), entry.size());
+
+    auto loaded = replayed(save, Journal::header() + entry);
+    EXPECT_EQ(loaded.credits, 5);
+    auto const f2 = loaded.getFactoryById(f->getId());
+    ASSERT_NE(f2, nullptr);
+    EXPECT_EQ(f2->getEntities().size(), 100);
+    EXPECT_EQ(storage(*f2, 7)->getInputStack(0)->getAmount(), 18);
+    EXPECT_EQ(storage(*f2, 8)->getInputStack(0)->getAmount(), 9);
+}
+
+TEST(Journal, ReplaysAddedAndRemovedEntitiesAndFactories) {
+    auto state = GameState();
+    auto const f1 = storageFactory(3);
+    auto const f2 = storageFactory(3);
+    state.addFactory(f1);
+    state.addFactory(f2);
+    auto journal = Journal();
+    auto const save = encodeGameState(state, &journal);
+
+    auto const removed = storage(*f1, 0);
+    f1->removeEntity(removed);
+    auto const added = std::make_shared<Storage>();
+    added->setMaxItemStacks(1);
+    f1->addEntity(added);
+    auto const entry1 = journal.delta(state);
+
+    state.removeFactoryById(f2->getId());
+    auto const f3 = storageFactory(2);
+    state.addFactory(f3);
+    storage(*f1, 0)->manualAdd(1, Resource::IronOre);
+    auto const entry2 = journal.delta(state);
+
+    auto loaded = replayed(save, Journal::header() + entry1 + entry2);
+    ASSERT_EQ(loaded.getFactories().size(), 2);
+    auto const f1_loaded = loaded.getFactoryById(f1->getId());
+    ASSERT_NE(f1_loaded, nullptr);
+    EXPECT_FALSE(f1_loaded->getEntityById(removed->getId()).has_value());
+    EXPECT_TRUE(f1_loaded->getEntityById(added->getId()).has_value());
+    EXPECT_EQ(storage(*f1_loaded, 0)->getInputStack(0)->getAmount(), 3);
+    auto const f3_loaded = loaded.getFactoryById(f3->getId());
+    ASSERT_NE(f3_loaded, nullptr);
+    EXPECT_EQ(f3_loaded->getEntities().size(), 2);
+}
+
+TEST(Journal, KeepsStoredFactoriesStored) {
+    auto state = GameState();
+    state.addStoredFactory(StoredFactory::of(*storageFactory(2)));
+    auto journal = Journal();
+    auto const save = encodeGameState(state, &journal);
+
+    state.advanceStoredFactories(5000);
+    auto const entry = journal.delta(state);
+
+    auto loaded = decodeGameState(save);
+    Journal::replay(Journal::header() + entry, loaded);
+    ASSERT_EQ(loaded.getStoredFactories().size(), 1);
+    EXPECT_EQ(loaded.getStoredFactories()[0].getStoredMs(), 5000);
+}
+
+TEST(Journal, FactoryThatWasStoredKeepsItsRemovals) {
+    auto state = GameState();
+    auto const f = storageFactory(2);
+    auto const belt = std::make_shared<Belt>(Belt(1));
+    belt->connectInput(0, storage(*f, 0), 0);
+    f->addEntity(belt);
+    state.addStoredFactory(StoredFactory::of(*f));
+    auto journal = Journal();
+    auto const save = encodeGameState(state, &journal);
+
+    // opened after the full save, the factory was stored when it was written
+    auto const opened = state.getFactoryById(f->getId());
+    opened->removeEntity(opened->getEntityArray<Belt>().front());
+    auto const entry = journal.delta(state);
+
+    auto loaded = replayed(save, Journal::header() + entry);
+    auto const f2 = loaded.getFactoryById(f->getId());
+    ASSERT_NE(f2, nullptr);
+    EXPECT_TRUE(f2->getEntityArray<Belt>().empty());
+    EXPECT_EQ(f2->getEntityArray<Storage>().size(), 2);
+
+    // later entries are deltas of the factory that was written whole
+    storage(*opened, 1)->manualAdd(3, Resource::IronOre);
+    auto const later = journal.delta(state);
+    loaded = replayed(save, Journal::header() + entry + later);
+    EXPECT_EQ(storage(*loaded.getFactoryById(f->getId()), 1)->getInputStack(0)->getAmount(), 5);
+}
+
+TEST(Journal, RunningFactoryWritesOnlyTheChangedBytes) {
+    auto state = GameState();
+    auto const f = std::make_shared<Factory>();
+    SyntheticFactory::build(f, {.entities = 2000});
+    f->step(60'000);
+    state.addFactory(f);
+    auto journal = Journal();
+    auto const save = encodeGameState(state, &journal);
+
+    f->step(60'000);
+    auto const entry = journal.delta(state);
+    EXPECT_LT(entry.size() * 4, save.size());
+
+    auto decoded = decodeGameState(save);
+    Journal::replay(Journal::header() + entry, decoded);
+    ASSERT_EQ(decoded.getStoredFactories().size(), 1);
+    EXPECT_EQ(decoded.getStoredFactories()[0].getData(), StoredFactory::of(*f).getData());
+}
+
+TEST(Journal, IgnoresACutOffEntry) {
+    auto state = GameState();
+    auto const f = storageFactory(2);
+    state.addFactory(f);
+    auto journal = Journal();
+    auto const save = encodeGameState(state, &journal);
+
+    storage(*f, 0)->manualAdd(1, Resource::IronOre);
+    auto const entry1 = journal.delta(state);
+    storage(*f, 0)->manualAdd(1, Resource::IronOre);
+    auto entry2 = journal.delta(state);
+    entry2.resize(entry2.size() - 3);
+
+    auto loaded = replayed(save, Journal::header() + entry1 + entry2);
+    EXPECT_EQ(storage(*loaded.getFactoryById(f->getId()), 0)->getInputStack(0)->getAmount(), 2);
+}
+
+TEST(Journal, CompactsOnceItGrows) {
+    auto state = GameState();
+    auto const f = storageFactory(10);
+    state.addFactory(f);
+    auto journal = Journal();
+    encodeGameState(state, &journal);
+
+    for (int i = 0; i < Journal::MAX_ENTRIES && !journal.needsCompaction(); i++) {
+        storage(*f, i % 10)->manualAdd(1, Resource::IronOre);
+        static_cast<void>(journal.delta(state));
+    }
+    EXPECT_TRUE(journal.needsCompaction());
+}
+
+TEST(Journal, AutosaveAppendsBetweenFullSaves) {
+    auto const file = testing::TempDir() + "journal_autosave.sav";
+    auto state = GameState();
+    auto const f = storageFactory(50);
+    state.addFactory(f);
+
+    auto autosave = Autosave(file, std::chrono::hours(1));
+    autosave.save(state);
+    autosave.flush();
+    EXPECT_FALSE(std::filesystem::exists(journalFileOf(file)));
+    auto const save_size = std::filesystem::file_size(file);
+
+    storage(*f, 3)->manualAdd(5, Resource::IronOre);
+    autosave.save(state);
+    state.credits = 77;
+    autosave.save(state);
+    autosave.flush();
+    EXPECT_EQ(autosave.getSavesWritten(), 3);
+    EXPECT_EQ(std::filesystem::file_size(file), save_size);
+    ASSERT_TRUE(std::filesystem::exists(journalFileOf(file)));
+
+    auto loaded = loadGameState(file);
+    EXPECT_EQ(loaded.credits, 77);
+    EXPECT_EQ(storage(*loaded.getFactoryById(f->getId()), 3)->getInputStack(0)->getAmount(), 9);
+
+    // a full save replaces the journal
+    saveGameState(state, file);
+    EXPECT_FALSE(std::filesystem::exists(journalFileOf(file)));
+    std::remove(file.c_str());
+}
@@ -1,7 +1,11 @@
+#include <cstdio>
 #include <memory>
+#include <sstream>
 
 #include "gtest/gtest.h"
 #include "../src/factory.h"
+#include "../src/game/game.h"
+#include "../src/game/save.h"
 
 using namespace Fac;
 
@@ -89,6 +93,23 @@ TEST(JSON, LinkedStacks) {
     EXPECT_EQ(b2->getInputStack(0).get()->getResource(), Resource::IronOre);
 }
 
+TEST(JSON, MachineWithTwoInputs) {
+    auto m = Machine(2, 1);
+    m.setRecipe(recipe_ReinforcedIronPlate);
+    m.getInputStack(1)->addAmount(7, Resource::Screw);
+    json const j = m;
+    auto const m2 = j.get<Machine>();
+    EXPECT_EQ(m2.getInputSlots(), 2);
+    EXPECT_EQ(m2.getInputStack(1)->getAmount(), 7);
+    EXPECT_EQ(m2.getInputStack(0)->getResource(), Resource::IronPlate);
+    EXPECT_EQ(m2.getOutputRpm(), m.getOutputRpm());
+}
+
+TEST(JSON, MachineWithoutRecipe) {
+    json const j = Machine();
+    EXPECT_FALSE(j.get<Machine>().getRecipe().has_value());
+}
+
 TEST(JSON, GameWorld) {
     auto w = Factory();
     auto m = std::make_shared<Machine>();
@@ -119,4 +140,80 @@ TEST(JSON, GameWorld) {
 
 TEST(JSON, ResourceExtractor) {
     // TBD
-}
\ No newline at end of file
+}
+
+TEST(JSON, GameStateLoadsFactoriesInParallel) {
+    auto state = GameState();
+    state.credits = 12;
+    for (int i = 0; i < 8; i++) {
+        auto const f = std::make_shared<Factory>();
+        auto const s = std::make_shared<Storage>();
+        s->setMaxItemStacks(1);
+        s->manualAdd(i + 1, Resource::IronOre);
+        const auto belt = std::make_shared<Belt>(Belt(1));
+        belt->connectInput(0, s, 0);
+        f->addEntity(s);
+        f->addEntity(belt);
+        state.addFactory(f);
+    }
+    json const j = state;
+
+    auto pool = ThreadPool(4);
+    auto loaded = GameState::fromJson(j, pool);
+
+    EXPECT_EQ(loaded.credits, 12);
+    auto const factories = state.getFactories();
+    auto const loaded_factories = loaded.getFactories();
+    ASSERT_EQ(loaded_factories.size(), factories.size());
+    for (size_t i = 0; i < factories.size(); i++) {
+        EXPECT_EQ(loaded_factories[i]->getId(), factories[i]->getId());
+        auto const s = loaded_factories[i]->getEntityArray<Storage>().front();
+        auto const belt = loaded_factories[i]->getEntityArray<Belt>().front();
+        EXPECT_EQ(s->getInputStack(0)->getAmount(), i + 1);
+        EXPECT_EQ(belt->getInputStack(0), s->getOutputStack(0));
+    }
+}
+
+TEST(JSON, GameStateRethrowsErrorsOfAFactory) {
+    auto state = GameState();
+    state.addFactory(std::make_shared<Factory>());
+    state.addFactory(std::make_shared<Factory>());
+    json j = state;
+    j["gameState"]["factories"][1]["entities"] = json::array({{{"type", "Unknown"}, {"data", {}}}});
+
+    auto pool = ThreadPool(2);
+    EXPECT_THROW(GameState::fromJson(j, pool), std::runtime_error);
+}
+
+TEST(JSON, StreamedGameStateEqualsTheDocument) {
+    auto state = GameState();
+    state.credits = 3.5;
+    state.resources[Resource::IronPlate] = 4;
+    for (int i = 0; i < 3; i++) {
+        auto const f = std::make_shared<Factory>();
+        auto const s = std::make_shared<Storage>();
+        s->setMaxItemStacks(1);
+        s->manualAdd(i + 1, Resource::IronOre);
+        const auto belt = std::make_shared<Belt>(Belt(1));
+        belt->connectInput(0, s, 0);
+        f->addEntity(s);
+        f->addEntity(belt);
+        if (i == 0) {
+            state.addStoredFactory(StoredFactory::of(*f));
+        } else {
+            state.addFactory(f);
+        }
+    }
+
+    auto out = std::ostringstream();
+    writeJson(out, state);
+    EXPECT_EQ(out.str(), json(state).dump());
+
+    auto const file = testing::TempDir() + "streamed_game_state.json";
+    saveGameState(state, file);
+    auto loaded = loadGameState(file);
+    EXPECT_EQ(loaded.credits, 3.5);
+    EXPECT_EQ(loaded.getFactories().size(), 3);
+    EXPECT_EQ(json(loaded).dump(), out.str());
+    std::remove(file.c_str());
+}
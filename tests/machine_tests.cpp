@@ -75,6 +75,17 @@ TEST(Machine, SetRecipe) {
     EXPECT_EQ(m->getInputStack(0)->getAmount(), 0);
 }
 
+TEST(Machine, ClearRecipe) {
+    auto m = Machine();
+    m.setRecipe(recipe_IronIngot);
+    EXPECT_EQ(m.getInputRpm(), 30);
+    m.setRecipe(std::nullopt);
+    EXPECT_FALSE(m.getRecipe().has_value());
+    EXPECT_EQ(m.getInputRpm(), 0);
+    EXPECT_EQ(m.getOutputRpm(), 0);
+    EXPECT_EQ(m.getSleepTime(), SLEEP_FOREVER);
+}
+
 TEST(Machine, MachineWithTwoInputResources) {
     auto f = Factory();
     auto m = std::make_shared<Machine>(2, 1);
@@ -37,9 +37,9 @@ TEST(Merger, CanMergeTwoBelts) {
         EXPECT_EQ(storage->getAmount(Resource::IronOre), 2);
         EXPECT_EQ(m1->getOutputStack(0)->getAmount(), 0);
         EXPECT_EQ(m2->getOutputStack(0)->getAmount(), 0);
-        EXPECT_EQ(belt1->_in_transit_stack.size(), 0);
-        EXPECT_EQ(belt2->_in_transit_stack.size(), 0);
-        EXPECT_EQ(belt3->_in_transit_stack.size(), 0);
+        EXPECT_EQ(belt1->getItemCount(), 0);
+        EXPECT_EQ(belt2->getItemCount(), 0);
+        EXPECT_EQ(belt3->getItemCount(), 0);
         EXPECT_EQ(mg->_in_transit_stack.size(), 0);
     });
 }
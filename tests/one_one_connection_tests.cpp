@@ -16,14 +16,14 @@ TEST(Belt, CanConnectAndMoveItems) {
     belt->update(1);
     // this should move the item from m1 to the belt
     EXPECT_TRUE(m1->getOutputStack(0)->isEmpty());
-    EXPECT_EQ(belt->_in_transit_stack.size(), 1);
-    EXPECT_EQ(belt->_in_transit_stack[0], Resource::IronIngot);
+    EXPECT_EQ(belt->getItemCount(), 1);
+    EXPECT_EQ(belt->getItems()[0], Resource::IronIngot);
     EXPECT_TRUE(m2->getInputStack(0)->isEmpty());
     EXPECT_TRUE(belt->getActive());
     EXPECT_FALSE(belt->getJammed());
     // +3 extra frames for the machine and belt to process and activate etc.
     belt->update(999+3);
-    EXPECT_EQ(belt->_in_transit_stack.size(), 0);
+    EXPECT_EQ(belt->getItemCount(), 0);
     EXPECT_EQ(belt->getActive(), false);
     EXPECT_EQ(belt->getJammed(), false);
 }
@@ -51,5 +51,5 @@ TEST(Belt, TestJammedConnection) {
     // their own instance
     //EXPECT_TRUE(m2->getInputStack(0)->isEmpty());
     // EXPECT_EQ(belt->getJammed(), true);
-    // EXPECT_EQ(belt->_in_transit_stack.size(), 1);
+    // EXPECT_EQ(belt->getItemCount(), 1);
 }
\ No newline at end of file
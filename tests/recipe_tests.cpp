@@ -15,6 +15,22 @@ TEST(RecipeTests, Recipe) {
     EXPECT_EQ(r.products[0].resource, Resource::IronIngot);
 }
 
+TEST(RecipeTests, TableIsConstexpr) {
+    static_assert(RECIPES.size() == RECIPE_COUNT);
+    static_assert(recipeById(RecipeId::IronIngot).processing_time_s == 2);
+    static_assert(recipeById(RecipeId::IronPlate).products[0].amount == 2);
+    static_assert(std::is_trivially_copyable_v<Recipe>);
+    EXPECT_EQ(recipeById(RecipeId::Cable).inputs[0].resource, Resource::Wire);
+    EXPECT_EQ(&recipeById(RecipeId::Stator), &RECIPES.back());
+}
+
+TEST(RecipeTests, HasAFixedNumberOfIngredients) {
+    auto r = Recipe{.inputs = {{Resource::IronOre, 1}, {Resource::Coal, 1}}, .processing_time_s = 1};
+    EXPECT_EQ(r.inputs.size(), 2);
+    EXPECT_TRUE(r.products.empty());
+    EXPECT_THROW(r.inputs.resize(Recipe::MAX_INGREDIENTS + 1), std::length_error);
+}
+
 TEST(RecipeTests, InAMachine) {
     auto m = Machine();
     m.setRecipe(recipe_IronIngot);
@@ -99,8 +99,8 @@ TEST(ReconnectLinks, StorageSplitterMachines) {
     EXPECT_EQ(x.getEntities()[2]->getId(), sp->getId());
     EXPECT_EQ(x.getEntities()[3]->getId(), belt2->getId());
     EXPECT_EQ(x.getEntities()[4]->getId(), m1->getId());
-    EXPECT_EQ(std::dynamic_pointer_cast<Storage>(x.getEntities()[0])->getAmount(Resource::IronOre), 24);
-    EXPECT_EQ(std::dynamic_pointer_cast<InputStackProvider>(x.getEntities()[1])->getInputStack(0)->getAmount(), 5);
+    EXPECT_EQ(std::dynamic_pointer_cast<Storage>(x.getEntities()[0])->getAmount(Resource::IronOre), 23);
+    EXPECT_EQ(std::dynamic_pointer_cast<InputStackProvider>(x.getEntities()[1])->getInputStack(0)->getAmount(), 4);
     EXPECT_EQ(std::dynamic_pointer_cast<OutputStackProvider>(x.getEntities()[2])->getOutputStack(0)->getAmount(), 0);
     EXPECT_EQ(std::dynamic_pointer_cast<InputStackProvider>(x.getEntities()[3])->getInputStack(0)->getAmount(), 0);
     EXPECT_EQ(std::dynamic_pointer_cast<IInputProvider>(x.getEntities()[4])->getInputStack(0)->getAmount(), 2);
@@ -135,4 +135,38 @@ TEST(ReconnectLinks, FeedStorage) {
     EXPECT_EQ(x.getEntities()[2]->getId(), belt->getId());
     auto result = std::dynamic_pointer_cast<Storage>(x.getEntities()[1]);
     EXPECT_EQ(result->getAmount(Resource::IronOre), 29);
-}
\ No newline at end of file
+}
+
+TEST(ReconnectLinks, SparseIds) {
+    auto w = Factory();
+    const auto m1 = std::make_shared<Machine>(Machine());
+    // ids far apart, so the entities are not found at their offset
+    for (int i = 0; i < 1000; i++) {
+        generate_id();
+    }
+    const auto belt = std::make_shared<Belt>(Belt(1));
+    for (int i = 0; i < 1000; i++) {
+        generate_id();
+    }
+    const auto m2 = std::make_shared<Machine>(Machine());
+    belt->connectInput(0, m1, 0);
+    m2->connectInput(0, belt, 0);
+    m1->setRecipe(recipe_IronIngot);
+    m2->setRecipe(recipe_IronPlate);
+    m1->getOutputStack(0)->addAmount(10, Resource::IronIngot);
+    belt->getOutputStack(0)->addAmount(1, Resource::IronIngot);
+    w.addEntity(m1);
+    w.addEntity(m2);
+    w.addEntity(belt);
+
+    json j = w;
+    auto x = j.get<Factory>();
+    x.advanceBy(1, [](){});
+
+    auto const belt2 = std::dynamic_pointer_cast<Belt>(x.getEntityById(belt->getId()).value());
+    auto const m12 = std::dynamic_pointer_cast<Machine>(x.getEntityById(m1->getId()).value());
+    auto const m22 = std::dynamic_pointer_cast<Machine>(x.getEntityById(m2->getId()).value());
+    EXPECT_EQ(belt2->getInputStack(0), m12->getOutputStack(0));
+    EXPECT_EQ(m12->getOutputStack(0)->getAmount(), 9);
+    EXPECT_EQ(m22->getInputStack(0)->getAmount(), 1);
+}
@@ -85,4 +85,39 @@ TEST(Removal, DoesNotAffectSerialzation) {
         EXPECT_EQ(m2_f2->getOutputStack(0)->getAmount(), 6);
         EXPECT_EQ(m2_f2->getInputStack(0)->getAmount(), 0);
     });
-}
\ No newline at end of file
+}
+
+TEST(Removal, InputsOfARemovedEntityAreResolvedAgain) {
+    auto f = Factory();
+    auto m = std::make_shared<Machine>(Machine());
+    const auto b = std::make_shared<Belt>(Belt(1));
+    m->setRecipe(recipe_IronIngot);
+    m->getOutputStack(0)->addAmount(5, Resource::IronIngot);
+    b->connectInput(0, m, 0);
+    f.addEntity(m);
+    f.addEntity(b);
+    EXPECT_EQ(b->getInputStack(0)->getAmount(), 5);
+    EXPECT_EQ(&b->inputStack(0), b->getInputStack(0).get());
+
+    f.removeEntity(m);
+    m.reset();
+    // the belt does not keep the output of the removed machine, neither on the update path
+    EXPECT_EQ(b->inputStack(0).getAmount(), 0);
+    EXPECT_EQ(b->getInputStack(0)->getAmount(), 0);
+    EXPECT_EQ(&b->inputStack(0), b->getInputStack(0).get());
+    // and the empty stack it sees now is the same on every access
+    b->getInputStack(0)->addAmount(1, Resource::IronIngot);
+    EXPECT_EQ(b->getInputStack(0)->getAmount(), 1);
+}
+
+TEST(Removal, ReconnectingAnInputSwitchesTheStack) {
+    const auto m1 = std::make_shared<Machine>(Machine());
+    const auto m2 = std::make_shared<Machine>(Machine());
+    const auto b = std::make_shared<Belt>(Belt(1));
+    m1->getOutputStack(0)->addAmount(1, Resource::IronIngot);
+    m2->getOutputStack(0)->addAmount(2, Resource::IronIngot);
+    b->connectInput(0, m1, 0);
+    EXPECT_EQ(b->getInputStack(0)->getAmount(), 1);
+    b->connectInput(0, m2, 0);
+    EXPECT_EQ(b->getInputStack(0)->getAmount(), 2);
+}
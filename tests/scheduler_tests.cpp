@@ -0,0 +1,187 @@
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+
+using namespace Fac;
+
+// builds extractor -> belt -> smelter -> belt -> storage
+static std::shared_ptr<Storage> buildSmelterLine(Factory &f) {
+    const auto n = std::make_shared<ResourceNode>(ResourceNode());
+    n->setResource(Resource::IronOre);
+    const auto e = std::make_shared<Extractor>(Extractor());
+    e->setResourceNode(n);
+    const auto b1 = std::make_shared<Belt>(Belt(1));
+    const auto m = std::make_shared<Machine>(Machine());
+    m->setRecipe(recipe_IronIngot);
+    const auto b2 = std::make_shared<Belt>(Belt(1));
+    const auto s = std::make_shared<Storage>(Storage());
+    s->setMaxItemStacks(10);
+    b1->connectInput(0, e, 0);
+    m->connectInput(0, b1, 0);
+    b2->connectInput(0, m, 0);
+    s->connectInput(0, b2, 0);
+    f.addEntity(n);
+    f.addEntity(e);
+    f.addEntity(b1);
+    f.addEntity(m);
+    f.addEntity(b2);
+    f.addEntity(s);
+    return s;
+}
+
+TEST(Scheduler, StepMatchesUpdatingEveryTick) {
+    auto f1 = Factory();
+    auto f2 = Factory();
+    const auto s1 = buildSmelterLine(f1);
+    const auto s2 = buildSmelterLine(f2);
+
+    for (int i = 0; i < 95 * 1000; i++) {
+        f1.update(1);
+    }
+    f2.step(95 * 1000);
+
+    EXPECT_GT(s1->getAmount(Resource::IronIngot), 0);
+    EXPECT_EQ(s1->getAmount(Resource::IronIngot), s2->getAmount(Resource::IronIngot));
+}
+
+TEST(Scheduler, WakesUpAnIdleBeltWhenItsInputChanges) {
+    auto f = Factory();
+    const auto m = std::make_shared<Machine>(Machine());
+    const auto b = std::make_shared<Belt>(Belt(1));
+    const auto s = std::make_shared<Storage>(Storage());
+    b->connectInput(0, m, 0);
+    s->connectInput(0, b, 0);
+    f.addEntity(m);
+    f.addEntity(b);
+    f.addEntity(s);
+
+    // nothing to transport, the belt goes to sleep
+    f.step(1000);
+    EXPECT_EQ(b->getSleepTime(), SLEEP_FOREVER);
+
+    m->getOutputStack(0)->addAmount(1, Resource::IronOre);
+    f.step(2000);
+    EXPECT_EQ(s->getAmount(Resource::IronOre), 1);
+}
+
+TEST(Scheduler, AdvancesAnHourOfAJammedExtractor) {
+    auto f = Factory();
+    const auto n = std::make_shared<ResourceNode>(ResourceNode());
+    n->setResource(Resource::IronOre);
+    const auto e = std::make_shared<Extractor>(Extractor());
+    e->setResourceNode(n);
+    f.addEntity(n);
+    f.addEntity(e);
+
+    auto called = false;
+    f.advanceBy(60 * 60 * 1000, [&called] { called = true; });
+
+    // the output stack is full after 100 items, the extractor stops until they are taken away
+    EXPECT_TRUE(called);
+    EXPECT_EQ(e->getExtractedAmount(), MAX_STACK_SIZE);
+    EXPECT_EQ(e->getOutputStack(0)->getAmount(), MAX_STACK_SIZE);
+}
+
+TEST(Scheduler, AdvanceByMatchesUpdatingEveryTick) {
+    auto f1 = Factory();
+    auto f2 = Factory();
+    const auto s1 = buildSmelterLine(f1);
+    const auto s2 = buildSmelterLine(f2);
+
+    for (int i = 0; i <= 10 * 60 * 1000; i++) {
+        f1.update(1);
+    }
+    f2.advanceBy(10 * 60 * 1000, [] {});
+
+    EXPECT_GT(s1->getAmount(Resource::IronIngot), 0);
+    EXPECT_EQ(s1->getAmount(Resource::IronIngot), s2->getAmount(Resource::IronIngot));
+}
+
+TEST(Scheduler, UnconnectedLinesRunInParallelLikeInSequence) {
+    auto f1 = Factory();
+    auto f2 = Factory();
+    f2.setThreadPool(std::make_shared<ThreadPool>(4));
+    std::vector<std::shared_ptr<Storage> > s1;
+    std::vector<std::shared_ptr<Storage> > s2;
+    for (int i = 0; i < 6; i++) {
+        s1.push_back(buildSmelterLine(f1));
+        s2.push_back(buildSmelterLine(f2));
+    }
+
+    f1.step(30 * 1000);
+    f2.step(30 * 1000);
+    for (int i = 0; i < 5 * 1000; i++) {
+        f1.update(1);
+        f2.update(1);
+    }
+
+    for (int i = 0; i < s1.size(); i++) {
+        EXPECT_GT(s1[i]->getAmount(Resource::IronIngot), 0);
+        EXPECT_EQ(s1[i]->getAmount(Resource::IronIngot), s2[i]->getAmount(Resource::IronIngot));
+    }
+}
+
+// builds extractor -> belts -> smelter -> storage, the belts feed one another
+static std::shared_ptr<Storage> buildBeltRun(Factory &f, int const belts) {
+    const auto n = std::make_shared<ResourceNode>(ResourceNode());
+    n->setResource(Resource::IronOre);
+    const auto e = std::make_shared<Extractor>(Extractor());
+    e->setResourceNode(n);
+    const auto m = std::make_shared<Machine>(Machine());
+    m->setRecipe(recipe_IronIngot);
+    const auto s = std::make_shared<Storage>(Storage());
+    s->setMaxItemStacks(10);
+    f.addEntity(n);
+    f.addEntity(e);
+    std::shared_ptr<GameWorldEntity> previous = e;
+    for (int i = 0; i < belts; i++) {
+        const auto b = std::make_shared<Belt>(Belt(i % 2 == 0 ? 1 : 2, 1 + i % 3));
+        b->connectInput(0, previous, 0);
+        f.addEntity(b);
+        previous = b;
+    }
+    m->connectInput(0, previous, 0);
+    s->connectInput(0, m, 0);
+    f.addEntity(m);
+    f.addEntity(s);
+    return s;
+}
+
+TEST(Scheduler, BeltRunsMatchUpdatingEveryTick) {
+    auto f1 = Factory();
+    auto f2 = Factory();
+    const auto s1 = buildBeltRun(f1, 12);
+    const auto s2 = buildBeltRun(f2, 12);
+
+    for (int i = 0; i < 95 * 1000; i++) {
+        f1.update(1);
+    }
+    f2.step(95 * 1000);
+
+    EXPECT_GT(s1->getAmount(Resource::IronIngot), 0);
+    EXPECT_EQ(s1->getAmount(Resource::IronIngot), s2->getAmount(Resource::IronIngot));
+}
+
+TEST(Scheduler, RelinkedBeltRunsAreScheduledAgain) {
+    auto f = Factory();
+    const auto m = std::make_shared<Machine>(Machine());
+    const auto s = std::make_shared<Storage>(Storage());
+    std::vector<std::shared_ptr<Belt> > belts;
+    f.addEntity(m);
+    for (int i = 0; i < 4; i++) {
+        belts.push_back(std::make_shared<Belt>(Belt(1)));
+        belts.back()->connectInput(0, i == 0 ? std::static_pointer_cast<GameWorldEntity>(m) : belts[i - 1], 0);
+        f.addEntity(belts.back());
+    }
+    s->connectInput(0, belts.back(), 0);
+    f.addEntity(s);
+    f.step(1000);
+
+    // take the third belt out of the run
+    f.removeEntity(belts[2]);
+    belts[3]->connectInput(0, belts[1], 0);
+    m->getOutputStack(0)->addAmount(10, Resource::IronOre);
+    f.step(30 * 1000);
+
+    EXPECT_EQ(s->getAmount(Resource::IronOre), 10);
+    EXPECT_EQ(belts[2]->getItemCount(), 0);
+}
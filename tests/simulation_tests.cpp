@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+#include "../src/game/simulation.h"
+
+using namespace Fac;
+
+TEST(Simulation, PublishesSnapshotsOfTheRunningFactories) {
+    auto state = GameState();
+    auto const factory = std::make_shared<Factory>();
+    const auto n = std::make_shared<ResourceNode>(ResourceNode());
+    n->setResource(Resource::IronOre, ResourceQuality::Pure);
+    const auto e = std::make_shared<Extractor>(Extractor());
+    e->setResourceNode(n);
+    factory->addEntity(n);
+    factory->addEntity(e);
+    state.addFactory(factory);
+
+    auto simulation = Simulation(state, std::make_shared<ThreadPool>(2));
+    auto const before = simulation.getSnapshot();
+    ASSERT_NE(before->getFactoryById(factory->getId()), nullptr);
+    EXPECT_EQ(before->getFactoryById(factory->getId())->resource_nodes[0].extractor_id, e->getId());
+
+    simulation.start();
+    simulation.post([](GameState &s) { s.credits = 42; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    simulation.stop();
+
+    auto const after = simulation.getSnapshot();
+    EXPECT_EQ(after->credits, 42);
+    EXPECT_GT(after->getFactoryById(factory->getId())->extractors[0].output_amount, 0);
+    // the old snapshot is never changed
+    EXPECT_EQ(before->getFactoryById(factory->getId())->extractors[0].output_amount, 0);
+}
+
+TEST(Simulation, PublishesSnapshotsOnlyOnceTheyAreRead) {
+    auto state = GameState();
+    state.addFactory(std::make_shared<Factory>());
+
+    auto simulation = Simulation(state, std::make_shared<ThreadPool>(1));
+    EXPECT_EQ(simulation.getSnapshotsPublished(), 1);
+    simulation.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    // the first snapshot was never read
+    EXPECT_EQ(simulation.getSnapshotsPublished(), 1);
+
+    static_cast<void>(simulation.getSnapshot());
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(simulation.getSnapshotsPublished(), 2);
+    simulation.stop();
+}
@@ -65,4 +65,37 @@ TEST(Stack, ReturnsNoneResourceWhenEmpty) {
     s.addAmount(10, Resource::IronOre);
     EXPECT_FALSE(s.isEmpty());
     EXPECT_EQ(s.getResource(), Resource::IronOre);
-}
\ No newline at end of file
+}
+
+TEST(Stack, TransfersWhatFits) {
+    auto source = Stack();
+    source.addAmount(80, Resource::IronOre);
+    auto target = Stack();
+    target.addAmount(50, Resource::IronOre);
+    EXPECT_EQ(source.transferTo(target), 50);
+    EXPECT_EQ(source.getAmount(), 30);
+    EXPECT_TRUE(target.isFull());
+    EXPECT_EQ(source.transferTo(target), 0);
+
+    auto empty = Stack();
+    EXPECT_EQ(source.transferTo(empty, 10), 10);
+    EXPECT_EQ(empty.getAmount(), 10);
+    EXPECT_EQ(empty.getResource(), Resource::IronOre);
+    EXPECT_EQ(source.transferTo(empty), 20);
+    EXPECT_TRUE(source.isEmpty());
+    EXPECT_EQ(source.getResource(), Resource::None);
+}
+
+TEST(Stack, TransfersNothingToOtherResource) {
+    auto source = Stack();
+    source.addAmount(10, Resource::IronOre);
+    auto target = Stack();
+    target.addOne(Resource::CopperOre);
+    EXPECT_EQ(source.transferTo(target), 0);
+
+    auto locked = Stack();
+    locked.lockResource(Resource::CopperOre);
+    EXPECT_EQ(source.transferTo(locked), 0);
+    EXPECT_EQ(source.getAmount(), 10);
+    EXPECT_TRUE(locked.isEmpty());
+}
@@ -20,7 +20,7 @@ TEST(Storage, CanStoreOneItem) {
 
     w.advanceBy(2 * 1000, [&]() {
         EXPECT_EQ(m->getOutputStack(0)->getAmount(), 0);
-        EXPECT_EQ(b->_in_transit_stack.size(), 0);
+        EXPECT_EQ(b->getItemCount(), 0);
         EXPECT_EQ(s->getInputStack(0)->getAmount(), 0);
         EXPECT_EQ(s->getAmount(Resource::IronOre), 1);
     });
@@ -130,4 +130,43 @@ TEST(Storage, CanFeedOutputConnectionWithItems) {
     w.advanceBy(2 * 1000, [&]() {
         EXPECT_EQ(m->getOutputStack(0)->getAmount(), 1);
     });
-}
\ No newline at end of file
+}
+
+TEST(Storage, KeepsTotalsOfSeveralResources) {
+    auto w = Factory();
+    const auto s = std::make_shared<Storage>(Storage());
+    s->setMaxItemStacks(3);
+    w.addEntity(s);
+
+    s->getInputStack(0)->addAmount(MAX_STACK_SIZE, Resource::IronOre);
+    w.advanceBy(100, [] {});
+    s->getInputStack(0)->addAmount(30, Resource::Cable);
+    w.advanceBy(100, [] {});
+    s->getInputStack(0)->addAmount(MAX_STACK_SIZE, Resource::IronOre);
+    w.advanceBy(100, [] {});
+
+    // the output stack took 5 iron ore first
+    EXPECT_EQ(s->getAmount(Resource::IronOre), 2 * MAX_STACK_SIZE);
+    EXPECT_EQ(s->getAmount(Resource::Cable), 30);
+    EXPECT_EQ(s->getInputStack(0)->getAmount(), 0);
+    EXPECT_TRUE(s->canStore(MAX_STACK_SIZE - 30, Resource::Cable));
+    EXPECT_FALSE(s->canStore(MAX_STACK_SIZE - 29, Resource::Cable));
+    EXPECT_TRUE(s->canStore(5, Resource::IronOre));
+    EXPECT_FALSE(s->canStore(6, Resource::IronOre));
+}
+
+TEST(Storage, TopsUpLoadedStacks) {
+    auto s = Storage();
+    s.setMaxItemStacks(3);
+    auto j = json(s);
+    auto half = Stack();
+    half.addAmount(MAX_STACK_SIZE / 2, Resource::IronOre);
+    j["storage"]["content"][0] = half;
+    j["storage"]["content"][2] = half;
+
+    auto loaded = j.get<Storage>();
+    EXPECT_EQ(loaded.getAmount(Resource::IronOre), MAX_STACK_SIZE);
+    // both halves fit into one stack, the other two stacks are free again
+    EXPECT_TRUE(loaded.canStore(2 * MAX_STACK_SIZE, Resource::Cable));
+    EXPECT_FALSE(loaded.canStore(2 * MAX_STACK_SIZE + 1, Resource::Cable));
+}
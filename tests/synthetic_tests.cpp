@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+#include "../src/dsl/synthetic.h"
+
+using namespace Fac;
+
+TEST(SyntheticFactory, HasTheRequestedSize) {
+    auto const f = std::make_shared<Factory>();
+    SyntheticFactory::build(f, {.entities = 500, .chain_depth = 2, .width = 3, .storages = 2});
+    EXPECT_GE(f->getEntities().size(), 500);
+    EXPECT_GT(f->getEntityArray<Machine>().size(), 0);
+    EXPECT_GT(f->getEntityArray<Splitter>().size(), 0);
+    EXPECT_GT(f->getEntityArray<Merger>().size(), 0);
+    EXPECT_GT(f->getEntityArray<Extractor>().size(), 0);
+    EXPECT_GE(f->getEntityArray<Storage>().size(), 4);
+}
+
+TEST(SyntheticFactory, UsesTheBeltTiers) {
+    auto const f = std::make_shared<Factory>();
+    SyntheticFactory::build(f, {.entities = 100, .belt_rpm = {60, 480}, .belt_length = 3});
+    auto slow = 0, fast = 0;
+    for (auto const &b: f->getEntityArray<Belt>()) {
+        EXPECT_EQ(b->getLength(), 3);
+        slow += b->getItemsPerSecond() == 1;
+        fast += b->getItemsPerSecond() == 8;
+    }
+    EXPECT_GT(slow, 0);
+    EXPECT_GT(fast, 0);
+    EXPECT_EQ(slow + fast, f->getEntityArray<Belt>().size());
+}
+
+TEST(SyntheticFactory, Produces) {
+    auto const f = std::make_shared<Factory>();
+    SyntheticFactory::build(f, {.entities = 1, .chain_depth = 2, .first_recipe = RecipeId::IronPlate});
+    f->advanceBy(60 * 1000, [] {});
+    EXPECT_GT(f->getProductionTotals()[Resource::IronIngot], 0);
+    EXPECT_GT(f->getProductionTotals()[Resource::IronPlate], 0);
+    EXPECT_GT(f->getEntityArray<Storage>()[0]->getAmount(Resource::IronPlate), 0);
+}
+
+TEST(SyntheticFactory, IsTheSameForTheSameOptions) {
+    auto const options = SyntheticFactoryOptions{.entities = 300, .chain_depth = 3};
+    auto const f1 = std::make_shared<Factory>();
+    SyntheticFactory::build(f1, options);
+    auto const f2 = std::make_shared<Factory>();
+    SyntheticFactory::build(f2, options);
+    EXPECT_EQ(f1->getEntities().size(), f2->getEntities().size());
+    EXPECT_EQ(f1->getEntityArray<Machine>().size(), f2->getEntityArray<Machine>().size());
+    EXPECT_EQ(f1->getEntityArray<Belt>().size(), f2->getEntityArray<Belt>().size());
+}
@@ -0,0 +1,143 @@
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+#include "../src/tools/thread_pool.h"
+
+using namespace Fac;
+
+TEST(ThreadPool, RunsEveryJobOnce) {
+    auto pool = ThreadPool(4);
+    std::vector<std::atomic<int> > calls(100);
+
+    for (int round = 0; round < 10; round++) {
+        pool.forEach(calls.size(), [&calls](size_t const i) { calls[i]++; });
+    }
+
+    for (auto const &c: calls) {
+        EXPECT_EQ(c, 10);
+    }
+}
+
+TEST(ThreadPool, RethrowsAfterAllJobsAreDone) {
+    auto pool = ThreadPool(4);
+    std::vector<std::atomic<int> > calls(100);
+
+    EXPECT_THROW(pool.forEach(calls.size(), [&calls](size_t const i) {
+        calls[i]++;
+        if (i % 10 == 0) {
+            throw std::runtime_error("job failed");
+        }
+    }), std::runtime_error);
+
+    for (auto const &c: calls) {
+        EXPECT_EQ(c, 1);
+    }
+    // the pool still works
+    pool.forEach(calls.size(), [&calls](size_t const i) { calls[i]++; });
+    EXPECT_EQ(calls[0], 2);
+}
+
+TEST(ThreadPool, FactoriesStepInParallelLikeInSequence) {
+    auto pool = ThreadPool(4);
+    std::vector<std::shared_ptr<Factory> > factories;
+    std::vector<std::shared_ptr<Extractor> > extractors;
+    for (int i = 0; i < 8; i++) {
+        auto const f = std::make_shared<Factory>();
+        const auto n = std::make_shared<ResourceNode>(ResourceNode());
+        n->setResource(Resource::IronOre);
+        const auto e = std::make_shared<Extractor>(Extractor());
+        e->setResourceNode(n);
+        const auto b = std::make_shared<Belt>(Belt(1));
+        const auto s = std::make_shared<Storage>(Storage());
+        s->setMaxItemStacks(10);
+        b->connectInput(0, e, 0);
+        s->connectInput(0, b, 0);
+        f->addEntity(n);
+        f->addEntity(e);
+        f->addEntity(b);
+        f->addEntity(s);
+        factories.push_back(f);
+        extractors.push_back(e);
+    }
+
+    pool.forEach(factories.size(), [&factories](size_t const i) { factories[i]->step(10 * 1000); });
+
+    for (auto const &e: extractors) {
+        EXPECT_EQ(e->getExtractedAmount(), extractors[0]->getExtractedAmount());
+    }
+    EXPECT_GT(extractors[0]->getExtractedAmount(), 0);
+}
+
+TEST(ThreadPool, ASingleJobLeavesTheWorkersToNestedCalls) {
+    auto pool = ThreadPool(4);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    pool.forEach(1, [&](size_t) {
+        pool.forEach(4, [&](size_t) {
+            {
+                std::lock_guard lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            }
+            // give a worker the time to take one of the jobs
+            auto const until = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            while (std::chrono::steady_clock::now() < until) {
+                if (std::lock_guard lock(mutex); threads.size() > 1) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        });
+    });
+
+    EXPECT_GT(threads.size(), 1);
+    EXPECT_EQ(pool.getParallelRuns(), 1);
+}
+
+TEST(ThreadPool, NestedCallsOfABusyPoolRunOnTheCallingThread) {
+    auto pool = ThreadPool(4);
+    std::vector<std::atomic<int> > calls(64);
+
+    pool.forEach(8, [&](size_t const i) {
+        pool.forEach(8, [&](size_t const j) { calls[i * 8 + j]++; });
+    });
+
+    for (auto const &c: calls) {
+        EXPECT_EQ(c, 1);
+    }
+    EXPECT_EQ(pool.getParallelRuns(), 1);
+}
+
+TEST(ThreadPool, ASingleFactoryUsesTheWholePool) {
+    auto const pool = std::make_shared<ThreadPool>(4);
+    auto const f = std::make_shared<Factory>();
+    std::vector<std::shared_ptr<Extractor> > extractors;
+    // unconnected lines, each one can run on its own thread
+    for (int i = 0; i < 4; i++) {
+        const auto n = std::make_shared<ResourceNode>(ResourceNode());
+        n->setResource(Resource::IronOre);
+        const auto e = std::make_shared<Extractor>(Extractor());
+        e->setResourceNode(n);
+        const auto s = std::make_shared<Storage>(Storage());
+        s->setMaxItemStacks(10);
+        s->connectInput(0, e, 0);
+        f->addEntity(n);
+        f->addEntity(e);
+        f->addEntity(s);
+        extractors.push_back(e);
+    }
+    f->setThreadPool(pool);
+
+    // like the simulation, which steps its factories through the pool
+    pool->forEach(1, [&f](size_t) { f->step(10 * 1000); });
+
+    EXPECT_EQ(pool->getParallelRuns(), 1);
+    for (auto const &e: extractors) {
+        EXPECT_EQ(e->getExtractedAmount(), extractors[0]->getExtractedAmount());
+    }
+    EXPECT_GT(extractors[0]->getExtractedAmount(), 0);
+}
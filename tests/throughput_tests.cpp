@@ -0,0 +1,134 @@
+#include "gtest/gtest.h"
+#include "../src/factory.h"
+#include "../src/throughput.h"
+
+using namespace Fac;
+
+static std::shared_ptr<Extractor> addExtractor(Factory &f, Resource const r,
+                                               ResourceQuality const quality = ResourceQuality::Normal) {
+    const auto n = std::make_shared<ResourceNode>(ResourceNode());
+    n->setResource(r, quality);
+    const auto e = std::make_shared<Extractor>(Extractor());
+    e->setResourceNode(n);
+    f.addEntity(n);
+    f.addEntity(e);
+    return e;
+}
+
+template<typename T>
+static std::shared_ptr<T> addConnected(Factory &f, std::shared_ptr<GameWorldEntity> const &source,
+                                       int const source_slot = 0) {
+    const auto e = std::make_shared<T>(T());
+    e->connectInput(0, source, source_slot);
+    f.addEntity(e);
+    return e;
+}
+
+TEST(Throughput, MachineLimitsTheExtractor) {
+    auto f = Factory();
+    const auto e = addExtractor(f, Resource::IronOre);
+    const auto b1 = addConnected<Belt>(f, e);
+    const auto m = addConnected<Machine>(f, b1);
+    m->setRecipe(recipe_IronIngot);
+    const auto b2 = addConnected<Belt>(f, m);
+    const auto s = addConnected<Storage>(f, b2);
+
+    const auto t = Throughput(f);
+
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(m->getId()), 30);
+    EXPECT_DOUBLE_EQ(t.getInputRpm(s->getId()), 30);
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(e->getId()), 30);
+    EXPECT_TRUE(t.isBlocked(e->getId()));
+    EXPECT_FALSE(t.isStarved(m->getId()));
+    EXPECT_FALSE(t.isBlocked(m->getId()));
+}
+
+TEST(Throughput, ProductionPerResource) {
+    auto f = Factory();
+    const auto e = addExtractor(f, Resource::IronOre);
+    const auto b1 = addConnected<Belt>(f, e);
+    const auto m = addConnected<Machine>(f, b1);
+    m->setRecipe(recipe_IronIngot);
+    addConnected<Storage>(f, addConnected<Belt>(f, m));
+
+    auto const rpm = Throughput(f).getProductionRpm(f);
+
+    EXPECT_DOUBLE_EQ(rpm[Resource::IronOre], 30);
+    EXPECT_DOUBLE_EQ(rpm[Resource::IronIngot], 30);
+    EXPECT_DOUBLE_EQ(rpm[Resource::CopperOre], 0);
+}
+
+TEST(Throughput, MachineIsStarved) {
+    auto f = Factory();
+    const auto e = addExtractor(f, Resource::Limestone, ResourceQuality::Impure);
+    const auto b1 = addConnected<Belt>(f, e);
+    const auto m = addConnected<Machine>(f, b1);
+    m->setRecipe(recipe_Concrete);
+    const auto b2 = addConnected<Belt>(f, m);
+    addConnected<Storage>(f, b2);
+
+    const auto t = Throughput(f);
+
+    // 30 limestone per minute are enough for 10 of the 15 concrete per minute
+    EXPECT_DOUBLE_EQ(t.getInputRpm(m->getId()), 30);
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(m->getId()), 10);
+    EXPECT_TRUE(t.isStarved(m->getId()));
+    EXPECT_FALSE(t.isBlocked(e->getId()));
+}
+
+TEST(Throughput, UnconnectedOutputBlocksTheLine) {
+    auto f = Factory();
+    const auto e = addExtractor(f, Resource::IronOre);
+    const auto b = addConnected<Belt>(f, e);
+    const auto m = addConnected<Machine>(f, b);
+    m->setRecipe(recipe_IronIngot);
+
+    const auto t = Throughput(f);
+
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(m->getId()), 0);
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(e->getId()), 0);
+    EXPECT_TRUE(t.isBlocked(m->getId()));
+}
+
+TEST(Throughput, MergerIsTheBottleneck) {
+    auto f = Factory();
+    const auto e1 = addExtractor(f, Resource::IronOre, ResourceQuality::Pure);
+    const auto e2 = addExtractor(f, Resource::IronOre, ResourceQuality::Pure);
+    const auto mg = std::make_shared<Merger>(Merger());
+    mg->connectInput(0, e1, 0);
+    mg->connectInput(1, e2, 0);
+    f.addEntity(mg);
+    const auto s = addConnected<Storage>(f, mg);
+
+    const auto t = Throughput(f);
+
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(mg->getId()), 60);
+    EXPECT_DOUBLE_EQ(t.getInputRpm(mg->getId(), 0), 30);
+    EXPECT_DOUBLE_EQ(t.getInputRpm(mg->getId(), 1), 30);
+    EXPECT_DOUBLE_EQ(t.getInputRpm(s->getId()), 60);
+    EXPECT_TRUE(t.isBlocked(e1->getId()));
+}
+
+TEST(Throughput, SplitterSharesAndOverflows) {
+    auto f = Factory();
+    const auto e = addExtractor(f, Resource::IronIngot);
+    const auto b = addConnected<Belt>(f, e);
+    const auto sp = addConnected<Splitter>(f, b);
+    const auto s = addConnected<Storage>(f, sp, 0);
+    const auto m = addConnected<Machine>(f, sp, 1);
+    m->setRecipe(recipe_IronRod);
+
+    const auto t = Throughput(f);
+
+    // the second output only feeds a machine without an outlet, everything goes to the storage
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(sp->getId(), 0), 60);
+    EXPECT_DOUBLE_EQ(t.getOutputRpm(sp->getId(), 1), 0);
+    EXPECT_DOUBLE_EQ(t.getInputRpm(s->getId()), 60);
+
+    addConnected<Storage>(f, m);
+    const auto t2 = Throughput(f);
+
+    // iron rods need 15 ingots per minute, the rest still goes to the storage
+    EXPECT_DOUBLE_EQ(t2.getOutputRpm(sp->getId(), 1), 15);
+    EXPECT_DOUBLE_EQ(t2.getOutputRpm(sp->getId(), 0), 45);
+}